@@ -0,0 +1,488 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+/*
+ * Benchmark for the step functions, run over every combination of the
+ * board sizes, densities, thread counts, kernels and modes asked for.
+ * Every repetition starts from the same board, and the median and 95th
+ * percentile of the repetitions are reported as a table, and optionally
+ * as CSV and JSON for scripts to pick up.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "gol_backend.h"
+#include "gol_kernel.h"
+#include "gol_sparse.h"
+#include "gol_workers.h"
+
+#define MAX_VALUES 32
+#define MAX_REPS   1024
+
+// cell updates to aim for in one repetition, to get past the clock.
+#define REP_CELLS  (1 << 26)
+
+typedef enum BenchMode
+{
+	BENCH_PLANE = 0,
+	BENCH_TORUS,
+	BENCH_KLEIN,
+	BENCH_MIRROR,
+	BENCH_SPARSE,
+	BENCH_MODES
+} BenchMode;
+
+static const char *modeNames[BENCH_MODES] = {
+	"plane", "torus", "klein", "mirror", "sparse"
+};
+
+typedef struct BenchResult
+{
+	const char *mode;
+	const char *kernel;
+	int boardSize;
+	double density;
+	int threads;
+	int generations;
+	double median;
+	double p95;
+	double cellsPerSecond;
+	const char *status;
+} BenchResult;
+
+static void printUsage(char *);
+static int parseList(const char *, double *);
+static double now(void);
+static void copyBoard(LifeBoard *, LifeBoard *);
+static int compareTimes(const void *, const void *);
+static boolean runBench(BenchResult *, BenchMode, LifeBoard *, int, int);
+static void printResult(FILE *, FILE *, FILE *, const BenchResult *, int);
+
+int main(int argc, char **argv)
+{
+	double sizes[MAX_VALUES] = { 64, 256, 1024, 4096, 16384 };
+	double densities[MAX_VALUES] = { 0.05, 0.25, 0.5 };
+	double threadCounts[MAX_VALUES] = { 1 };
+	int sizeCount = 5;
+	int densityCount = 3;
+	int threadCount = 1;
+	int warmups = 3;
+	int reps = 11;
+	char *modes = "plane,torus,sparse";
+	char *kernels = NULL;
+	char *rulestring = NULL;
+	char *csvPath = NULL;
+	char *jsonPath = NULL;
+	char *name = argv[0];
+	int option;
+
+	while ((option = getopt(argc, argv, "s:d:t:k:m:R:w:r:c:j:")) != -1) {
+		switch (option) {
+		case 's':
+			sizeCount = parseList(optarg, sizes);
+			break;
+		case 'd':
+			densityCount = parseList(optarg, densities);
+			break;
+		case 't':
+			threadCount = parseList(optarg, threadCounts);
+			break;
+		case 'k':
+			kernels = optarg;
+			break;
+		case 'm':
+			modes = optarg;
+			break;
+		case 'R':
+			rulestring = optarg;
+			break;
+		case 'w':
+			warmups = atoi(optarg);
+			break;
+		case 'r':
+			reps = atoi(optarg);
+			break;
+		case 'c':
+			csvPath = optarg;
+			break;
+		case 'j':
+			jsonPath = optarg;
+			break;
+		default:
+			printUsage(name);
+			return 0;
+		}
+	}
+
+	if (sizeCount <= 0 || densityCount <= 0 || threadCount <= 0 ||
+	    warmups < 0 || reps <= 0 || reps > MAX_REPS) {
+		printUsage(name);
+		return 0;
+	}
+
+	LifeRule rule;
+	if (rulestring) {
+		if (!parseLifeRule(rulestring, &rule)) {
+			printf("Rule %s is not a valid rulestring, exiting.\n",
+			       rulestring);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		setLifeRule(&rule);
+	}
+
+	FILE *csv = csvPath ? fopen(csvPath, "w") : NULL;
+	FILE *json = jsonPath ? fopen(jsonPath, "w") : NULL;
+	if ((csvPath && !csv) || (jsonPath && !json)) {
+		printf("Not possible to open the output files, exiting.\n");
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	if (csv) {
+		fprintf(csv, "mode,kernel,size,density,threads,generations,"
+			"median_s,p95_s,cells_per_s,status\n");
+	}
+	if (json) {
+		fprintf(json, "[\n");
+	}
+	printf("%-6s %-7s %6s %7s %7s %6s %12s %12s %12s\n", "mode",
+	       "kernel", "size", "density", "threads", "gens", "median ms",
+	       "p95 ms", "Gcells/s");
+
+	int results = 0;
+	for (int s = 0; s < sizeCount; s++) {
+		int boardSize = (int)sizes[s];
+		LifeBoard *initial = createLifeBoard(boardSize);
+		LifeBoard *lifeBoard = createLifeBoard(boardSize);
+		if (!initial || !lifeBoard) {
+			printf("Not possible to allocate a board of size %d, "
+			       "skipping it.\n", boardSize);
+			destroyLifeBoard(initial);
+			destroyLifeBoard(lifeBoard);
+			continue;
+		}
+
+		for (int d = 0; d < densityCount; d++) {
+			randomizeBoard(initial, (uint64_t)boardSize, densities[d]);
+
+			for (int t = 0; t < threadCount; t++) {
+				int threads = (int)threadCounts[t];
+				lifeBoard->workers = threads > 1 ?
+					createWorkerPool(threads) : NULL;
+				if (threads > 1 && !lifeBoard->workers) {
+					printf("Failed to start %d worker "
+					       "threads, skipping them.\n",
+					       threads);
+					continue;
+				}
+
+				for (int k = 0; getLifeKernelName(k) != NULL; k++) {
+					const char *kernel = getLifeKernelName(k);
+					if ((kernels && !strstr(kernels, kernel)) ||
+					    !selectLifeKernel(kernel)) {
+						continue;
+					}
+
+					for (int m = 0; m < BENCH_MODES; m++) {
+						if (!strstr(modes, modeNames[m])) {
+							continue;
+						}
+
+						// runs that fail are listed as well.
+						BenchResult result;
+						copyBoard(initial, lifeBoard);
+						(void)runBench(&result, (BenchMode)m,
+							       lifeBoard, warmups,
+							       reps);
+						result.kernel = kernel;
+						result.density = densities[d];
+						result.threads = threads;
+						printResult(stdout, csv, json, &result,
+							    results++);
+					}
+				}
+
+				destroyWorkerPool(lifeBoard->workers);
+				lifeBoard->workers = NULL;
+			}
+		}
+
+		destroyLifeBoard(initial);
+		destroyLifeBoard(lifeBoard);
+	}
+
+	if (json) {
+		fprintf(json, "\n]\n");
+		(void)fclose(json);
+	}
+	if (csv) {
+		(void)fclose(csv);
+	}
+
+	return 0;
+}
+
+
+/**
+ *
+ *
+ */
+static void printUsage(char *name)
+{
+	printf("%s [-s sizes] [-d densities] [-t threads] [-k kernels] "
+	       "[-m modes] [-R rule] [-w warmups] [-r repetitions] "
+	       "[-c csv file] [-j json file]\n", name);
+	printf("lists are separated by commas, modes are plane, torus, "
+	       "klein, mirror and\nsparse; plane, torus and sparse unless "
+	       "given.\n");
+	printf("runs that were not timed are listed with the status skipped, "
+	       "sparse with B0\nrules, or failed, out of memory.\n");
+	printf("kernels:");
+	for (int i = 0; getLifeKernelName(i) != NULL; i++) {
+		printf(" %s", getLifeKernelName(i));
+	}
+	printf("\n");
+}
+
+
+/**
+ * Read a list of numbers separated by commas.
+ *
+ * @Return the number of values read, or -1 if there were too many.
+ */
+static int parseList(const char *list, double *values)
+{
+	int count = 0;
+	char *end;
+
+	while (*list != '\0') {
+		if (count == MAX_VALUES) {
+			return -1;
+		}
+		values[count++] = strtod(list, &end);
+		list = *end == ',' ? end + 1 : end;
+		if (end == list && *end != '\0') {
+			return -1;
+		}
+	}
+
+	return count;
+}
+
+
+/**
+ * Seconds on the monotonic clock.
+ */
+static double now(void)
+{
+	struct timespec time;
+	(void)clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+
+/**
+ * Copy the cells of one board to another of the same size.
+ */
+static void copyBoard(LifeBoard *from, LifeBoard *to)
+{
+	for (int y = 0; y < from->boardSize; y++) {
+		(void)memcpy(lifeRow(to, y), lifeRow(from, y),
+			     sizeof(uint64_t) * from->words);
+	}
+
+	markBoardChanged(to);
+}
+
+
+/**
+ *
+ */
+static int compareTimes(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/**
+ * Time reps repetitions, after warmups untimed ones, each of them
+ * starting from the board as it is given. The status of the result says
+ * whether it was timed, skipped or failed.
+ *
+ * @Return false if out of memory, or the sparse board cannot run the rule
+ * in use
+ */
+static boolean runBench(BenchResult *result, BenchMode mode,
+			LifeBoard *lifeBoard, int warmups, int reps)
+{
+	double times[MAX_REPS];
+	double cells = (double)lifeBoard->boardSize * lifeBoard->boardSize;
+	int generations = cells >= REP_CELLS ? 1 : (int)(REP_CELLS / cells);
+	LifeBoard *initial = createLifeBoard(lifeBoard->boardSize);
+	SparseBoard *sparse = NULL;
+
+	result->mode = modeNames[mode];
+	result->boardSize = lifeBoard->boardSize;
+	result->generations = 0;
+	result->median = 0.0;
+	result->p95 = 0.0;
+	result->cellsPerSecond = 0.0;
+	result->status = "failed";
+
+	if (!initial) {
+		return false;
+	}
+	copyBoard(lifeBoard, initial);
+	if (mode == BENCH_SPARSE) {
+		if (lifeRule.birth & 1) {
+			destroyLifeBoard(initial);
+			result->status = "skipped";
+			return false;
+		}
+		sparse = createSparseBoard();
+		if (!sparse) {
+			destroyLifeBoard(initial);
+			return false;
+		}
+		sparse->workers = lifeBoard->workers;
+	}
+
+	boolean ok = true;
+	for (int i = -warmups; i < reps && ok; i++) {
+		if (sparse) {
+			ok = copyToSparseBoard(sparse, initial, 0, 0);
+		} else {
+			copyBoard(initial, lifeBoard);
+		}
+
+		double start = now();
+		for (int g = 0; g < generations && ok; g++) {
+			switch (mode) {
+			case BENCH_PLANE:
+				calculateLife(lifeBoard);
+				break;
+			case BENCH_TORUS:
+				calculateLifeTorus(lifeBoard);
+				break;
+			case BENCH_KLEIN:
+				calculateLifeKlein(lifeBoard);
+				break;
+			case BENCH_MIRROR:
+				calculateLifeMirror(lifeBoard);
+				break;
+			default:
+				ok = calculateSparseLife(sparse);
+				break;
+			}
+		}
+		double time = now() - start;
+
+		if (i >= 0) {
+			times[i] = time;
+		}
+	}
+
+	destroySparseBoard(sparse);
+	destroyLifeBoard(initial);
+	if (!ok) {
+		return false;
+	}
+
+	// nearest rank percentiles.
+	qsort(times, (size_t)reps, sizeof(double), &compareTimes);
+	result->status = "ok";
+	result->generations = generations;
+	result->median = times[(reps - 1) / 2];
+	result->p95 = times[(reps * 95 + 99) / 100 - 1];
+	result->cellsPerSecond = cells * generations / result->median;
+
+	return true;
+}
+
+
+/**
+ * Print one result as a table row, and to the CSV and JSON files if open;
+ * one that was not timed has its status in place of the times.
+ */
+static void printResult(FILE *table, FILE *csv, FILE *json,
+			const BenchResult *result, int index)
+{
+	if (strcmp(result->status, "ok") != 0) {
+		fprintf(table, "%-6s %-7s %6d %7.3f %7d %6s %12s\n",
+			result->mode, result->kernel, result->boardSize,
+			result->density, result->threads, "-",
+			result->status);
+		(void)fflush(table);
+		if (csv) {
+			fprintf(csv, "%s,%s,%d,%g,%d,,,,,%s\n", result->mode,
+				result->kernel, result->boardSize,
+				result->density, result->threads,
+				result->status);
+		}
+		if (json) {
+			fprintf(json, "%s  {\"mode\": \"%s\", \"kernel\": "
+				"\"%s\", \"size\": %d, \"density\": %g, "
+				"\"threads\": %d, \"status\": \"%s\"}",
+				index > 0 ? ",\n" : "", result->mode,
+				result->kernel, result->boardSize,
+				result->density, result->threads,
+				result->status);
+		}
+		return;
+	}
+
+	fprintf(table, "%-6s %-7s %6d %7.3f %7d %6d %12.3f %12.3f %12.3f\n",
+		result->mode, result->kernel, result->boardSize,
+		result->density, result->threads, result->generations,
+		result->median * 1e3, result->p95 * 1e3,
+		result->cellsPerSecond / 1e9);
+	(void)fflush(table);
+
+	if (csv) {
+		fprintf(csv, "%s,%s,%d,%g,%d,%d,%.9f,%.9f,%.6g,%s\n",
+			result->mode, result->kernel, result->boardSize,
+			result->density, result->threads, result->generations,
+			result->median, result->p95, result->cellsPerSecond,
+			result->status);
+	}
+
+	if (json) {
+		fprintf(json, "%s  {\"mode\": \"%s\", \"kernel\": \"%s\", "
+			"\"size\": %d, \"density\": %g, \"threads\": %d, "
+			"\"generations\": %d, \"median_s\": %.9f, "
+			"\"p95_s\": %.9f, \"cells_per_s\": %.6g, "
+			"\"status\": \"%s\"}",
+			index > 0 ? ",\n" : "", result->mode, result->kernel,
+			result->boardSize, result->density, result->threads,
+			result->generations, result->median, result->p95,
+			result->cellsPerSecond, result->status);
+	}
+}
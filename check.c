@@ -0,0 +1,375 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+/*
+ * Checks the step functions against a plain per-cell reference: every
+ * kernel the machine runs, under a few rules, on boards from one cell up
+ * past a tile, for every topology, with and without worker threads,
+ * statistics and hashing. Blocked torus steps are checked against the
+ * same number of single steps. Prints each mismatch and exits with a
+ * failure if there was one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_backend.h"
+#include "gol_kernel.h"
+#include "gol_workers.h"
+
+#define GENERATIONS 12
+
+static const char *rules[] = { "B3/S23", "B36/S23", "B2/S", "B1/S12",
+			       "B03/S23", "B0/S8" };
+static const int sizes[] = { 1, 2, 5, 17, 63, 64, 65, 130, 300 };
+static const int depths[] = { 1, 2, 3, 8, 40 };
+
+/*
+ * A board kept as one byte a cell, stepped by counting neighbours one
+ * cell at a time.
+ */
+typedef struct ReferenceBoard {
+	int size;
+	char *cells;
+	char *next;
+} ReferenceBoard;
+
+static boolean readCell(ReferenceBoard *, int, int, LifeTopology);
+static void stepReference(ReferenceBoard *, LifeTopology);
+static void fillBoards(LifeBoard *, ReferenceBoard *, uint64_t);
+static boolean sameCells(LifeBoard *, ReferenceBoard *);
+static boolean sameBoards(LifeBoard *, LifeBoard *);
+static void setupBoard(LifeBoard *, int, boolean);
+static int checkTopologies(const char *, const char *);
+static int checkBlocked(const char *);
+
+int main(void)
+{
+	int failures = 0;
+	const char *kernel;
+
+	for (int k = 0; (kernel = getLifeKernelName(k)) != NULL; k++) {
+		if (!selectLifeKernel(kernel)) {
+			printf("%s: not supported here, skipping it.\n",
+			       kernel);
+			continue;
+		}
+
+		for (unsigned r = 0; r < sizeof(rules) / sizeof(*rules);
+		     r++) {
+			failures += checkTopologies(kernel, rules[r]);
+		}
+		failures += checkBlocked(kernel);
+	}
+
+	(void)selectLifeKernel(NULL);
+	printf("%d failures.\n", failures);
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/**
+ * Reads the cell at x, y of the reference board, following the topology
+ * past the edges; cells past a dead edge are dead.
+ */
+static boolean readCell(ReferenceBoard *board, int x, int y,
+			LifeTopology topology)
+{
+	int size = board->size;
+
+	switch (topology) {
+	case LIFE_DEAD_EDGES:
+		if (x < 0 || y < 0 || x >= size || y >= size) {
+			return false;
+		}
+		break;
+	case LIFE_TORUS:
+		x = (x + size) % size;
+		y = (y + size) % size;
+		break;
+	case LIFE_KLEIN_BOTTLE:
+		x = (x + size) % size;
+		if (y < 0 || y >= size) {
+			y = (y + size) % size;
+			x = size - 1 - x;
+		}
+		break;
+	default:
+		x = x < 0 ? 0 : (x >= size ? size - 1 : x);
+		y = y < 0 ? 0 : (y >= size ? size - 1 : y);
+		break;
+	}
+
+	return board->cells[y * size + x];
+}
+
+
+/**
+ * Steps the reference board one generation under the rule in use.
+ */
+static void stepReference(ReferenceBoard *board, LifeTopology topology)
+{
+	char *swap;
+
+	for (int y = 0; y < board->size; y++) {
+		for (int x = 0; x < board->size; x++) {
+			int count = 0;
+			boolean alive = board->cells[y * board->size + x];
+			boolean inside = x > 0 && y > 0 &&
+					 x < board->size - 1 &&
+					 y < board->size - 1;
+
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					if (dx == 0 && dy == 0) {
+						continue;
+					}
+					count += inside ?
+						board->cells[(y + dy) *
+							     board->size +
+							     x + dx] :
+						readCell(board, x + dx, y + dy,
+							 topology);
+				}
+			}
+
+			board->next[y * board->size + x] =
+				((alive ? lifeRule.survival : lifeRule.birth) >>
+				 count) & 1;
+		}
+	}
+
+	swap = board->cells;
+	board->cells = board->next;
+	board->next = swap;
+}
+
+
+/**
+ * Fills both boards with the same random cells. On boards larger than a
+ * few tiles a band across the middle is left empty, so that the tiles
+ * skipped for being quiet are checked as well.
+ */
+static void fillBoards(LifeBoard *lifeBoard, ReferenceBoard *reference,
+		       uint64_t seed)
+{
+	int size = reference->size;
+
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			boolean alive = randomWord(seed, (uint64_t)y * size + x) %
+					3 == 0;
+
+			if (size > 200 && y > 50 && y < size - 50) {
+				alive = false;
+			}
+			reference->cells[y * size + x] = alive;
+			(void)setCell(lifeBoard, x, y, alive);
+		}
+	}
+}
+
+
+/**
+ * Tells whether the board holds the same cells as the reference.
+ */
+static boolean sameCells(LifeBoard *lifeBoard, ReferenceBoard *reference)
+{
+	for (int y = 0; y < reference->size; y++) {
+		for (int x = 0; x < reference->size; x++) {
+			if (getCell(lifeBoard, x, y) !=
+			    reference->cells[y * reference->size + x]) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * Tells whether the two boards hold the same cells.
+ */
+static boolean sameBoards(LifeBoard *first, LifeBoard *second)
+{
+	for (int y = 0; y < first->boardSize; y++) {
+		if (memcmp(lifeRow(first, y), lifeRow(second, y),
+			   sizeof(uint64_t) * first->words) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * Gives the board its worker threads and, when asked, statistics and a
+ * hash, so that the paths they take through the step are checked too.
+ */
+static void setupBoard(LifeBoard *lifeBoard, int threads, boolean extras)
+{
+	if (threads > 1) {
+		lifeBoard->workers = createWorkerPool(threads);
+	}
+	if (extras) {
+		(void)enableBoardStatistics(lifeBoard);
+		(void)enableBoardHash(lifeBoard);
+	}
+}
+
+
+/**
+ * Steps boards of every size in every topology under the rule, once on a
+ * single thread and on three, each with and without statistics and a
+ * hash, and compares them with the reference. Returns the number of mismatches.
+ */
+static int checkTopologies(const char *kernel, const char *rulestring)
+{
+	LifeRule rule;
+	int failures = 0;
+
+	if (!parseLifeRule(rulestring, &rule)) {
+		printf("%s: rule %s does not parse.\n", kernel, rulestring);
+		return 1;
+	}
+	setLifeRule(&rule);
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+		for (int t = 0; t < LIFE_TOPOLOGIES; t++) {
+			for (int variant = 0; variant < 4; variant++) {
+				int threads = variant & 1 ? 3 : 1;
+				ReferenceBoard reference;
+				LifeBoard *lifeBoard;
+				int generation;
+
+				reference.size = sizes[s];
+				reference.cells = calloc(sizes[s], sizes[s]);
+				reference.next = calloc(sizes[s], sizes[s]);
+				lifeBoard = createLifeBoard(sizes[s]);
+				if (!reference.cells || !reference.next ||
+				    !lifeBoard) {
+					printf("Failed to allocate the boards, "
+					       "exiting.\n");
+					(void)fflush(NULL);
+					exit(EXIT_FAILURE);
+				}
+				setupBoard(lifeBoard, threads, variant >= 2);
+				fillBoards(lifeBoard, &reference,
+					   (uint64_t)sizes[s] * 8 + t);
+
+				for (generation = 1; generation <= GENERATIONS;
+				     generation++) {
+					calculateLifeTopology(lifeBoard,
+							      (LifeTopology)t);
+					stepReference(&reference,
+						      (LifeTopology)t);
+					if (!sameCells(lifeBoard, &reference)) {
+						break;
+					}
+				}
+
+				if (generation <= GENERATIONS) {
+					printf("%s: %s on a %s board of %d, "
+					       "%d threads%s, differs at "
+					       "generation %d.\n",
+					       kernel, rulestring,
+					       getLifeTopologyName(
+						       (LifeTopology)t),
+					       sizes[s], threads,
+					       variant >= 2 ? ", statistics "
+							      "and a hash"
+							    : "",
+					       generation);
+					failures++;
+				}
+
+				destroyWorkerPool(lifeBoard->workers);
+				lifeBoard->workers = NULL;
+				destroyLifeBoard(lifeBoard);
+				free(reference.cells);
+				free(reference.next);
+			}
+		}
+	}
+
+	return failures;
+}
+
+
+/**
+ * Steps torus boards of every size in blocks of several depths, with one
+ * and three threads, and compares them with boards stepped one generation
+ * at a time. Returns the number of mismatches.
+ */
+static int checkBlocked(const char *kernel)
+{
+	LifeRule rule;
+	int failures = 0;
+
+	(void)parseLifeRule("B3/S23", &rule);
+	setLifeRule(&rule);
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+		for (unsigned d = 0; d < sizeof(depths) / sizeof(*depths);
+		     d++) {
+			for (int threads = 1; threads <= 3; threads += 2) {
+				LifeBoard *single = createLifeBoard(sizes[s]);
+				LifeBoard *blocked = createLifeBoard(sizes[s]);
+
+				if (!single || !blocked) {
+					printf("Failed to allocate the boards, "
+					       "exiting.\n");
+					(void)fflush(NULL);
+					exit(EXIT_FAILURE);
+				}
+				setupBoard(blocked, threads, false);
+				randomizeBoard(single, (uint64_t)sizes[s], 0.4);
+				randomizeBoard(blocked, (uint64_t)sizes[s], 0.4);
+
+				for (int i = 0; i < depths[d]; i++) {
+					calculateLifeTorus(single);
+				}
+				calculateLifeTorusBlocked(blocked, depths[d]);
+
+				if (!sameBoards(single, blocked)) {
+					printf("%s: blocks of %d on a torus "
+					       "of %d, %d threads, differ "
+					       "from single steps.\n",
+					       kernel, depths[d], sizes[s],
+					       threads);
+					failures++;
+				}
+
+				destroyWorkerPool(blocked->workers);
+				blocked->workers = NULL;
+				destroyLifeBoard(single);
+				destroyLifeBoard(blocked);
+			}
+		}
+	}
+
+	return failures;
+}
@@ -25,76 +25,516 @@
 #include <string.h>
 #include <GL/glfw.h>
 #include <assert.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 
+#include "gol_arena.h"
 #include "gol_backend.h"
+#include "gol_domain.h"
 #include "gol_frontend.h"
+#include "gol_hashlife.h"
+#include "gol_kernel.h"
+#include "gol_pattern.h"
+#include "gol_period.h"
+#include "gol_profile.h"
+#include "gol_simulation.h"
+#include "gol_snapshot.h"
+#include "gol_soup.h"
+#include "gol_sparse.h"
+#include "gol_stream.h"
+#include "gol_transport.h"
+#include "gol_workers.h"
 #include "gol.h"
 
-#include "list.h"
-
 #define TITLE   "Game of Life - the ressurection"
 #define VERSION "0.3.2"
 #define AUTHOR  "(c) Peter Jönsson (peter.joensson@gmail.com)"
 #define LICENSE "Licensed under the MIT License"
 #define MAXLEN 256
 
-// Uncomment and recompile to get debug traces.
-#define _DEBUG_ 
+// Nodes HashLife may keep between steps, at about 72 bytes each.
+#define HASHLIFE_MAX_NODES (1 << 21)
+
+// Generations between full copies of the board in the history.
+#define HISTORY_KEY_INTERVAL 64
+
+// Generations between checkpoints unless told otherwise.
+#define CHECKPOINT_INTERVAL 10000
+
+// Generations a soup runs for at most, and back to look for a repeat in,
+// unless told otherwise.
+#define SOUP_GENERATIONS 50000
+#define SOUP_WINDOW      256
 
 extern int running;
-extern int step;
-extern int simulation;
+extern unsigned long long jumpSize;
 extern float sleepTime;
 extern float sleepFactor;
 extern LifeBoard *board;
+extern SparseBoard *sparse;
+extern LifeSimulation *lifeSimulation;
 extern float scaleFactor;
-extern CircularList *clist;
+extern int verbosity;
 
 static void printUsage(char *);
+static void jumpGenerations(unsigned long long *);
+static unsigned long long runHeadless(unsigned long long, unsigned long long,
+				      const char *, LifeCheckpoint *,
+				      unsigned long long, LifeStream *,
+				      LifePeriod *, FILE *, LifeProfile *, int,
+				      LifeTopology);
+static void finishCheckpoint(LifeCheckpoint *, const char *,
+			     unsigned long long);
+static boolean saveBoard(LifeBoard *, unsigned long long, const char *);
+static void runBatch(unsigned long long, uint64_t, unsigned long long,
+		     unsigned long long, int, int, const char *);
+static void runDistributed(int, int, int, unsigned long long, uint64_t,
+			   double, const char *, int);
 
 int main(int argc, char **argv)
 {
 	int boardSize = 0;
+	int threads = 1;
+	char *kernel = NULL;
+	boolean unbounded = false;
+	unsigned long long generations = 0;
+	char *output = NULL;
+	char *rulestring = NULL;
+	double historyBudget = -1.0;
+	char *snapshot = NULL;
+	char *pattern = NULL;
+	long patternX = 0;
+	long patternY = 0;
+	char *checkpointPath = NULL;
+	unsigned long long checkpointInterval = CHECKPOINT_INTERVAL;
+	LifeCheckpoint *checkpoint = NULL;
+	char *streamPath = NULL;
+	unsigned long long streamEvery = 1;
+	LifeStream *stream = NULL;
+	unsigned long long periodWindow = 0;
+	LifePeriod *period = NULL;
+	char *statisticsPath = NULL;
+	FILE *statistics = NULL;
+	LifeProfile *profile = NULL;
+	unsigned long long soups = 0;
+	uint64_t seed = 1;
+	double density = 0.5;
+	int depth = 1;
+	LifeTopology topology = LIFE_TORUS;
+	boolean hasTopology = false;
+	int ranksX = 0;
+	int ranksY = 0;
+	char *addresses = NULL;
+	int rank = -1;
 	char windowTitle[MAXLEN];
+	char *name = argv[0];
+	char *end;
+	int option;
+
+	while ((option = getopt(argc, argv, "a:b:c:d:e:f:g:hi:j:k:l:m:n:o:p:q:r:s:t:uvw:x:y:z:")) != -1) {
+		switch (option) {
+		case 'a':
+			if (sscanf(optarg, "%ld,%ld", &patternX,
+				   &patternY) != 2) {
+				printUsage(name);
+				return 0;
+			}
+			break;
+		case 'b':
+			soups = strtoull(optarg, NULL, 10);
+			break;
+		case 'c':
+			checkpointPath = optarg;
+			break;
+		case 'd':
+			periodWindow = strtoull(optarg, NULL, 10);
+			break;
+		case 'e':
+			streamEvery = strtoull(optarg, NULL, 10);
+			break;
+		case 'f':
+			density = atof(optarg);
+			if (density < 0.0 || density > 1.0) {
+				printUsage(name);
+				return 0;
+			}
+			break;
+		case 'g':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'h':
+			printUsage(name);
+			return 0;
+		case 'i':
+			checkpointInterval = strtoull(optarg, NULL, 10);
+			break;
+		case 'j':
+			jumpSize = strtoull(optarg, NULL, 10);
+			break;
+		case 'k':
+			kernel = optarg;
+			break;
+		case 'l':
+			snapshot = optarg;
+			break;
+		case 'm':
+			if (strcmp(optarg, "huge") == 0) {
+				lifeHugePages = true;
+				break;
+			}
+			historyBudget = strtod(optarg, &end);
+			if (strcmp(end, ",huge") == 0) {
+				lifeHugePages = true;
+			} else if (*end != '\0' || end == optarg) {
+				printUsage(name);
+				return 0;
+			}
+			break;
+		case 'n':
+			generations = strtoull(optarg, NULL, 10);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'p':
+			pattern = optarg;
+			break;
+		case 'q':
+			if (!parseLifeTopology(optarg, &topology)) {
+				printUsage(name);
+				return 0;
+			}
+			hasTopology = true;
+			break;
+		case 'r':
+			rulestring = optarg;
+			break;
+		case 's':
+			streamPath = optarg;
+			break;
+		case 't':
+			statisticsPath = optarg;
+			break;
+		case 'u':
+			unbounded = true;
+			break;
+		case 'v':
+			verbosity++;
+			break;
+		case 'w':
+			depth = atoi(optarg);
+			if (depth <= 0) {
+				printUsage(name);
+				return 0;
+			}
+			break;
+		case 'x':
+			if (sscanf(optarg, "%dx%d", &ranksX, &ranksY) != 2 ||
+			    ranksX <= 0 || ranksY <= 0) {
+				printUsage(name);
+				return 0;
+			}
+			break;
+		case 'y':
+			if (strncmp(optarg, "tcp:", 4) != 0) {
+				printUsage(name);
+				return 0;
+			}
+			addresses = optarg + 4;
+			break;
+		case 'z':
+			rank = atoi(optarg);
+			break;
+		default:
+			printUsage(name);
+			return 0;
+		}
+	}
+	argc -= optind;
+	argv += optind;
 
-	if (argc < 4) {
-		printUsage(argv[0]);
+	// without a window there is no scale factor or update interval.
+	boolean headless = generations > 0 || soups > 0;
+	if (headless && argc >= 1) {
+		boardSize = atoi(argv[0]);
+		if (argc > 1) {
+			threads = atoi(argv[1]);
+		}
+	} else if (argc < 3) {
+		printUsage(name);
 
 		return 0;
 	} else {
-		boardSize = atoi(argv[1]);
-		scaleFactor = atof(argv[2]);
-		sleepTime = atof(argv[3]);
+		boardSize = atoi(argv[0]);
+		scaleFactor = atof(argv[1]);
+		sleepTime = atof(argv[2]);
+		if (argc > 3) {
+			threads = atoi(argv[3]);
+		}
+	}
+
+	// pick the fastest kernel unless one was asked for.
+	if (!selectLifeKernel(kernel)) {
+		printf("Kernel %s is not supported on this machine, exiting.\n",
+		       kernel);
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	// a snapshot brings its own size, generation and rule.
+	unsigned long long generation = 0;
+	LifeRule rule;
+	if (snapshot) {
+		board = loadSnapshot(snapshot, &generation, &rule);
+		if (!board) {
+			printf("Not possible to load a snapshot from %s, "
+			       "exiting.\n", snapshot);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		boardSize = board->boardSize;
+		setLifeRule(&rule);
+	} else {
+		board = createLifeBoard(boardSize);
+		if (!board) {
+			printf("Not possible to allocate memory for game board, "
+			       "exiting.\n");
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// only start a pool if there is more than one thread to run on.
+	if (threads > 1) {
+		board->workers = createWorkerPool(threads);
+		if (!board->workers) {
+			printf("Failed to start %d worker threads, exiting.\n",
+			       threads);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// start from a pattern rather than at random, in its rule if it has one.
+	if (pattern) {
+		boolean hasRule = false;
+		if (!loadPattern(board, pattern, patternX, patternY, &rule,
+				 &hasRule)) {
+			printf("Not possible to load a pattern from %s, "
+			       "exiting.\n", pattern);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		if (hasRule) {
+			setLifeRule(&rule);
+		}
+	} else if (!snapshot) {
+		randomizeBoard(board, seed, density);
+	}
+
+	if (rulestring) {
+		if (!parseLifeRule(rulestring, &rule)) {
+			printf("Rule %s is not a valid rulestring, exiting.\n",
+			       rulestring);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		setLifeRule(&rule);
+	}
+
+	// births out of nothing would fill the space around the board.
+	if ((lifeRule.birth & 1) && (unbounded || jumpSize > 0)) {
+		printf("Rules with B0 cannot be run unbounded or jumped, "
+		       "exiting.\n");
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	// HashLife and the ranks only know about the torus, and the sparse
+	// board has no edges at all.
+	if (topology != LIFE_TORUS && (unbounded || jumpSize > 0 || ranksX > 0)) {
+		printf("Only a torus can be jumped, split over ranks or run "
+		       "unbounded, exiting.\n");
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	// soups always run in a box of dead cells.
+	if (hasTopology && soups > 0) {
+		printf("Soups always run with dead edges, a topology cannot "
+		       "be given, exiting.\n");
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	// every soup starts from a random square of its own.
+	if (soups > 0) {
+		if (snapshot || pattern || unbounded || jumpSize > 0 ||
+		    checkpointPath || streamPath || statisticsPath) {
+			printf("Soups only start from random squares on bounded "
+			       "boards, exiting.\n");
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+
+		destroyWorkerPool(board->workers);
+		destroyLifeBoard(board);
+		runBatch(soups, seed,
+			 generations > 0 ? generations : SOUP_GENERATIONS,
+			 periodWindow > 0 ? periodWindow : SOUP_WINDOW,
+			 boardSize, threads, output);
+
+		return 0;
+	}
+
+	// every rank seeds its own part of the board, the same way each time.
+	if (ranksX > 0) {
+		if (generations == 0 || snapshot || pattern || unbounded ||
+		    jumpSize > 0 || checkpointPath || streamPath ||
+		    statisticsPath || periodWindow > 0 || output) {
+			printf("Distributed boards only start at random and run "
+			       "a number of generations, exiting.\n");
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		if (rank >= 0 && !addresses) {
+			printf("A single rank needs the addresses of the others, "
+			       "exiting.\n");
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+
+		destroyWorkerPool(board->workers);
+		destroyLifeBoard(board);
+		runDistributed(ranksX, ranksY, boardSize, generations, seed,
+			       density, addresses, rank);
+
+		return 0;
+	}
+
+	// only the board itself is written, not what has grown out of it.
+	if ((checkpointPath || streamPath || periodWindow > 0 ||
+	     statisticsPath) && unbounded) {
+		printf("Checkpoints, streams and periods are only for bounded "
+		       "boards, exiting.\n");
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
 	}
 
 	// make sure that the input values are somewhat sane.
-	if (scaleFactor < 2.0f) {
+	if (!headless && scaleFactor < 2.0f) {
 		scaleFactor = 2.0f;
 		printf("Scale factor too low, resetting to 2.0\n");
 		(void)fflush(NULL);
 	}
 
 	assert(boardSize > 0);
-	assert(scaleFactor > 0.0f);
-	assert(sleepTime > 0);
+	assert(headless || scaleFactor > 0.0f);
+	assert(headless || sleepTime > 0);
+	assert(threads > 0);
 
-	// get the random juice flowing.
-#ifdef __APPLE__
-	sranddev();
-#else
-	srandom(0x2a);
-#endif
 	// we scale with 2 since we will move (0, 0) to the bottom
 	// left corner later.
 	scaleFactor = scaleFactor * 2.0f;
 	int windowSize = boardSize * (int)scaleFactor;
-	board = createLifeBoard(boardSize);
-	randomizeBoard(board);
-	
-	if(!board) {
-		printf("Not possible to allocate memory for game board, exiting.\n");
-		(void)fflush(NULL);
-		exit(EXIT_FAILURE);
+
+	// skip ahead before the first generation is shown.
+	if (jumpSize > 0) {
+		jumpGenerations(&generation);
+	}
+
+	// let the board grow past the window, which shows its corner.
+	if (unbounded) {
+		sparse = createSparseBoard();
+		if (!sparse) {
+			printf("Not possible to allocate memory for sparse board, "
+			       "exiting.\n");
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		sparse->workers = board->workers;
+		if (!copyToSparseBoard(sparse, board, 0, 0)) {
+			printf("Not possible to allocate memory for sparse "
+			       "board, exiting.\n");
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// write the board every so often without holding up the simulation.
+	if (checkpointPath) {
+		checkpoint = createCheckpoint(checkpointPath, boardSize);
+		if (!checkpoint) {
+			printf("Failed to start the checkpoint thread, "
+			       "exiting.\n");
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// hand generations to other programs, starting with this one. Only
+	// the window has to keep going when the stream falls behind.
+	if (streamPath) {
+		stream = createStream(streamPath, boardSize, streamEvery,
+				      headless);
+		if (!stream) {
+			printf("Not possible to open a stream to %s, exiting.\n",
+			       streamPath);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		(void)streamGeneration(stream, board, generation);
+	}
+
+	// count the cells as they are calculated, a line of CSV a generation.
+	if (statisticsPath) {
+		statistics = fopen(statisticsPath, "w");
+		if (!statistics || !enableBoardStatistics(board)) {
+			printf("Not possible to write statistics to %s, "
+			       "exiting.\n", statisticsPath);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		writeBoardStatistics(statistics, board, 0);
+	}
+
+	// run as fast as possible and report how fast that was.
+	if (headless) {
+		// stop as soon as the board repeats itself, if asked to.
+		if (periodWindow > 0) {
+			period = createPeriodDetector(periodWindow);
+			if (!period || !enableBoardHash(board)) {
+				printf("Not possible to allocate memory for the "
+				       "board hashes, exiting.\n");
+				(void)fflush(NULL);
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		// time every generation only if the times are printed.
+		if (verbosity > 0) {
+			profile = createProfile();
+		}
+
+		generation += runHeadless(generation, generations, output,
+					  checkpoint, checkpointInterval,
+					  stream, period, statistics, profile,
+					  depth, topology);
+		destroyProfile(profile);
+		destroyStream(stream);
+		finishCheckpoint(checkpoint, checkpointPath, generation);
+		destroyPeriodDetector(period);
+		if (statistics) {
+			(void)fclose(statistics);
+		}
+		destroySparseBoard(sparse);
+		destroyWorkerPool(board->workers);
+		destroyLifeBoard(board);
+
+		return 0;
 	}
 
 	if(!glfwInit()) {
@@ -113,55 +553,97 @@ int main(int argc, char **argv)
 	// set default window title
 	snprintf(windowTitle, MAXLEN, TITLE);
 
-	// move (0,0) to lower left corner to make rendering easier.
-	float s = scaleFactor / (float)board->boardSize;	
-	(void)glTranslatef(-1.0f,-1.0f,0.0f);
-	
+	// by default keep as much history as ten boards of int cells took.
+	size_t historyBytes = historyBudget >= 0.0 ?
+		(size_t)(historyBudget * 1024.0 * 1024.0) :
+		10 * sizeof(int) * (size_t)boardSize * boardSize;
+
+	// calculate on a thread of its own, drawing whatever it has done last.
+	lifeSimulation = createSimulation(board, sparse, generation);
+	if (!lifeSimulation) {
+		printf("Not possible to allocate memory for the frames, "
+		       "exiting.\n");
+		(void)fflush(NULL);
+		glfwTerminate();
+		exit(EXIT_FAILURE);
+	}
+	lifeSimulation->delay = sleepTime;
+	// the sparse board does not fit in the history.
+	if (!sparse) {
+		lifeSimulation->history = createHistory(board, historyBytes,
+							HISTORY_KEY_INTERVAL);
+	}
+	lifeSimulation->checkpoint = checkpoint;
+	lifeSimulation->checkpointInterval = checkpointInterval;
+	lifeSimulation->stream = stream;
+	lifeSimulation->statistics = statistics;
+	// the phases are timed all along, to be printed whenever asked for.
+	profile = createProfile();
+	lifeSimulation->profile = profile;
+	lifeSimulation->jumpSize = jumpSize;
+	lifeSimulation->topology = topology;
+	lifeSimulation->maxNodes = HASHLIFE_MAX_NODES;
+	if (!startSimulation(lifeSimulation)) {
+		printf("Failed to start the simulation thread, exiting.\n");
+		(void)fflush(NULL);
+		glfwTerminate();
+		exit(EXIT_FAILURE);
+	}
+
 	//setup callback functions for keyboard and mouse.
 	(void)glfwSetKeyCallback(&processKeyPress);
 	(void)glfwSetMouseButtonCallback(&processMouseClick);
 
-	int generation = 0;
-
-	clist = createCircularList(10);
+	// draw at the refresh rate.
+	glfwSwapInterval(1);
 
+	unsigned long long shown = ~0ULL;
 	while (running) {
 		
+		uint64_t start = startTimer();
 		glfwPollEvents();
+		stopTimer(profile, LIFE_PHASE_POLL, start);
 		if (!glfwGetWindowParam(GLFW_OPENED)) {
-			return 0;
+			break;
 		}
 
-		// sleep and calculate next generation.
-		if (simulation) {
-			(void)glClear(GL_COLOR_BUFFER_BIT);
-			renderBoard(board, s);
-			glfwSwapBuffers();
-#ifdef _DEBUG_
-			printf("Sleeping %f seconds.\n", sleepTime);
-			(void)fflush(NULL);
-#endif
-			glfwSleep(sleepTime);
-			// store old board in list.
-			addToCircularList(clist, board->matrix);
-			// calculate the new board.
-			calculateLifeTorus(board);
-			
-			snprintf(windowTitle, MAXLEN, "%s (%d generation)",
+		start = startTimer();
+		LifeBoard *frame = readFrame(lifeSimulation, &generation);
+		(void)glClear(GL_COLOR_BUFFER_BIT);
+		renderBoard(frame);
+		stopTimer(profile, LIFE_PHASE_RENDER, start);
+
+		start = startTimer();
+		glfwSwapBuffers();
+		stopTimer(profile, LIFE_PHASE_SWAP, start);
+
+		if (generation != shown) {
+			snprintf(windowTitle, MAXLEN, "%s (%llu generation)",
 				 TITLE, generation);
 			glfwSetWindowTitle(windowTitle);
-			generation++;
-			if(step) {
-				simulation = GL_FALSE;
-			}
+			shown = generation;
 		}
-		
 	}
 
 	// Cleanup before we leave.
+	stopSimulation(lifeSimulation);
+	if (verbosity > 0) {
+		printProfile(stdout, profile);
+	}
+	destroyProfile(profile);
+	destroyStream(stream);
+	if (statistics) {
+		(void)fclose(statistics);
+	}
+	finishCheckpoint(checkpoint, checkpointPath,
+			 lifeSimulation->generation);
+	destroyHistory(lifeSimulation->history);
+	destroySimulation(lifeSimulation);
+	destroyBoardTexture();
 	glfwTerminate();
-	destroyCircularList(clist);
-//	destroyLifeBoard(board);
+	destroySparseBoard(sparse);
+	destroyWorkerPool(board->workers);
+	destroyLifeBoard(board);
 
 	return 0;
 }
@@ -175,6 +657,525 @@ static void printUsage(char *name)
 {
 	printf("%s - %s\n", TITLE, VERSION);
 	printf("%s - %s\n", LICENSE, AUTHOR);
-	printf("%s <board size> <scale factor> <update interval>\n", name);
+	printf("%s [-u] [-r rule] [-q topology] [-m MiB[,huge]] [-j generations] "
+	       "[-k kernel] [-l snapshot] [-c checkpoint] [-i generations] "
+	       "[-p pattern] [-a x,y] [-g seed] [-f density] [-s stream] "
+	       "[-e generations] [-t statistics] [-v] <board size> <scale factor> "
+	       "<update interval> [threads]\n", name);
+	printf("%s -n generations [-u] [-o file] [-r rule] [-q topology] "
+	       "[-j generations] [-k kernel] [-l snapshot] [-c checkpoint] [-i generations] "
+	       "[-p pattern] [-a x,y] [-g seed] [-f density] [-s stream] "
+	       "[-e generations] [-d generations] [-t statistics] [-w depth] "
+	       "[-m huge] [-v] <board size> [threads]\n",
+	       name);
+	printf("%s -b soups [-g seed] [-n generations] [-d generations] "
+	       "[-o file] [-r rule]\n[-k kernel] <board size> [threads]\n",
+	       name);
+	printf("%s -x PXxPY -n generations [-y tcp:host:port,...] [-z rank] "
+	       "[-g seed] [-f density]\n[-r rule] [-k kernel] <subdomain size>\n",
+	       name);
+	printf("rules are given as B3/S23 or 23/3, Conway's is the default.\n");
+	printf("topologies are dead, with dead cells past the edges, torus, "
+	       "the default, klein,\na torus flipped over at the top and "
+	       "bottom, and mirror, with the edges\nreflected.\n");
+	printf("without a snapshot or pattern the board starts with cells "
+	       "live at random with\nthe chance -f, 0.5 unless given, the "
+	       "same for the same seed -g every time.\n");
+	printf("a snapshot loaded with -l sets the board size, generation and "
+	       "rule; the board is\nwritten to the checkpoint every %d "
+	       "generations and on exit.\n", CHECKPOINT_INTERVAL);
+	printf("patterns in the RLE, Life 1.06 or plaintext format are placed "
+	       "with their corner\nat x,y, 0,0 unless given with -a.\n");
+	printf("every generation, or every one given with -e, is written to "
+	       "the stream as it\nchanged from the one before, see "
+	       "gol_stream.h; - is standard output.\n");
+	printf("-d stops once the board repeats one of that many generations "
+	       "before it and\nprints the period.\n");
+	printf("-t writes the population, births, deaths and bounding box of "
+	       "every generation\nas CSV.\n");
+	printf("-b runs that many soups of %dx%d random cells, each on a "
+	       "board of its own, until\nthey repeat one of the last -d "
+	       "generations or reach -n, and writes how they\nended to -o "
+	       "or standard output. Soup n of seed -g always comes out the "
+	       "same. The boards\nhave dead edges, so -q cannot be "
+	       "given.\n", SOUP_SIZE, SOUP_SIZE);
+	printf("-x splits a torus into PX by PY subdomains, each run by a "
+	       "process of its own\nand a multiple of 64 cells square, "
+	       "which swap their edges every generation\nthrough shared "
+	       "memory, or over TCP with a host:port for every rank given "
+	       "with\n-y. -z runs just that rank, otherwise all of them are "
+	       "started here.\n");
+	printf("-w calculates depth generations at a time, a band of rows "
+	       "at a time, for\nheadless boards too big for the cache; only on a "
+	       "torus without -s, -t and -d.\n");
+	printf("-m keeps at most that many MiB of past generations to step "
+	       "back through, on\ntop of four boards of working space; ten "
+	       "bytes a cell unless given. With ,huge\nor just huge the "
+	       "boards and the history are backed by huge pages where the\n"
+	       "system has them.\n");
+	printf("-v prints how long polling, stepping, recording, drawing and "
+	       "swapping took\non exit, T prints it at any time; -vv also "
+	       "prints every key and click.\n");
+	printf("kernels:");
+	for (int i = 0; getLifeKernelName(i) != NULL; i++) {
+		printf(" %s", getLifeKernelName(i));
+	}
+	printf("\n");
 }
 
+
+/**
+ * Jump jumpSize generations ahead with HashLife.
+ */
+static void jumpGenerations(unsigned long long *generation)
+{
+	if (jumpSize == 0) {
+		return;
+	}
+
+	// HashLife only knows the board, not what has grown out of it.
+	if (sparse) {
+		printf("Not possible to jump on an unbounded board.\n");
+		(void)fflush(NULL);
+		return;
+	}
+
+	int size = board->boardSize;
+	if (size < 16 || (size & (size - 1)) != 0) {
+		printf("Board size is not a power of two of at least 16, "
+		       "jumping as if there were only dead cells around it.\n");
+		(void)fflush(NULL);
+	}
+
+	if (!jumpBoard(board, jumpSize, HASHLIFE_MAX_NODES)) {
+		printf("Not possible to jump that far with the memory "
+		       "for HashLife, not jumping.\n");
+		(void)fflush(NULL);
+		return;
+	}
+
+	*generation += jumpSize;
+}
+
+
+/**
+ * Calculate generations generations without a window, or until the board
+ * repeats itself if there is a period detector, then print the throughput
+ * and peak memory use, and save the board to output if given. Every
+ * interval generations the board goes to the checkpoint writer, if there
+ * is one, and every generation to the stream and its statistics to the
+ * statistics file, if there are. The time every generation took goes to
+ * the profile, if there is one, which is printed with the rest. Without a
+ * stream, statistics or period detector, which see every generation, the
+ * generations on a torus are calculated depth at a time, up to each
+ * checkpoint.
+ *
+ * @Return the number of generations calculated
+ */
+static unsigned long long runHeadless(unsigned long long generation,
+				      unsigned long long generations,
+				      const char *output,
+				      LifeCheckpoint *checkpoint,
+				      unsigned long long interval,
+				      LifeStream *stream, LifePeriod *period,
+				      FILE *statistics, LifeProfile *profile,
+				      int depth, LifeTopology topology)
+{
+	struct timespec start;
+	struct timespec end;
+	struct rusage usage;
+	unsigned long long cells = 0;
+	boolean repeated = detectPeriod(period, getBoardHash(board),
+					generation);
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &start);
+	boolean blocked = depth > 1 && !sparse && !stream && !statistics &&
+		!period && topology == LIFE_TORUS;
+	unsigned long long i;
+	for (i = 0; i < generations && !repeated; i++) {
+		uint64_t step = profile ? startTimer() : 0;
+		if (sparse) {
+			cells += (unsigned long long)sparse->tileCount *
+				SPARSE_TILE_SIZE * SPARSE_TILE_SIZE;
+			if (!calculateSparseLife(sparse)) {
+				printf("Not possible to allocate memory for "
+				       "sparse board, stopping.\n");
+				(void)fflush(NULL);
+				break;
+			}
+		} else if (blocked) {
+			unsigned long long steps = generations - i;
+			if (steps > (unsigned long long)depth) {
+				steps = (unsigned long long)depth;
+			}
+			if (checkpoint && interval > 0 &&
+			    steps > interval - (generation + i) % interval) {
+				steps = interval - (generation + i) % interval;
+			}
+			calculateLifeTorusBlocked(board, (int)steps);
+			i += steps - 1;
+		} else {
+			calculateLifeTopology(board, topology);
+		}
+		stopTimer(profile, LIFE_PHASE_STEP, step);
+		if (checkpoint && interval > 0 &&
+		    (generation + i + 1) % interval == 0) {
+			(void)requestCheckpoint(checkpoint, board,
+						generation + i + 1);
+		}
+		(void)streamGeneration(stream, board, generation + i + 1);
+		writeBoardStatistics(statistics, board, generation + i + 1);
+		if (period) {
+			repeated = detectPeriod(period, getBoardHash(board),
+						generation + i + 1);
+		}
+	}
+	(void)clock_gettime(CLOCK_MONOTONIC, &end);
+	generations = i;
+
+	// tiles that are skipped count as updated, they are just quick.
+	if (!sparse) {
+		cells = (unsigned long long)board->boardSize * board->boardSize *
+			generations;
+	}
+
+	double seconds = (double)(end.tv_sec - start.tv_sec) +
+		(double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	(void)getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	long peak = (long)(usage.ru_maxrss / 1024);
+#else
+	long peak = (long)usage.ru_maxrss;
+#endif
+
+	// keep out of the way of a stream on standard output.
+	FILE *report = stream && stream->file == stdout ? stderr : stdout;
+	fprintf(report, "%llu generations in %.3f seconds using the %s "
+		"kernel\n", generations, seconds, getLifeKernel());
+	fprintf(report, "%.1f generations/s\n", (double)generations / seconds);
+	fprintf(report, "%.4g cell updates/s\n", (double)cells / seconds);
+	fprintf(report, "%ld KiB peak resident memory\n", peak);
+	if (repeated) {
+		fprintf(report, "period %llu from generation %llu\n",
+			period->period, period->start);
+	}
+	printProfile(report, profile);
+	(void)fflush(NULL);
+
+	if (output) {
+		copyFromSparseBoard(sparse, board, 0, 0);
+		if (!saveBoard(board, generation + generations, output)) {
+			printf("Not possible to write the board to %s.\n", output);
+			(void)fflush(NULL);
+		}
+	}
+
+	return generations;
+}
+
+
+/**
+ * Run a batch of soups on boards of boardSize across threads threads, and
+ * write how each of them ended to output, or standard output without one.
+ * How fast that was goes to standard error, out of the way.
+ */
+static void runBatch(unsigned long long soups, uint64_t seed,
+		     unsigned long long generations, unsigned long long window,
+		     int boardSize, int threads, const char *output)
+{
+	struct timespec start;
+	struct timespec end;
+	WorkerPool *pool = NULL;
+
+	SoupSearch *search = createSoupSearch(boardSize, soups, seed,
+					      generations, window);
+	if (!search) {
+		printf("Not possible to run soups on a board of %d, exiting.\n",
+		       boardSize);
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+	if (threads > 1) {
+		pool = createWorkerPool(threads);
+		if (!pool) {
+			printf("Failed to start %d worker threads, exiting.\n",
+			       threads);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &start);
+	boolean done = runSoupSearch(search, pool);
+	(void)clock_gettime(CLOCK_MONOTONIC, &end);
+	destroyWorkerPool(pool);
+	if (!done) {
+		printf("Not possible to allocate memory for the soups, "
+		       "exiting.\n");
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	FILE *file = output ? fopen(output, "w") : stdout;
+	if (!file) {
+		printf("Not possible to write the soups to %s, exiting.\n",
+		       output);
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+	writeSoupResults(file, search);
+	if (file != stdout) {
+		(void)fclose(file);
+	}
+
+	unsigned long long settled = 0;
+	for (unsigned long long i = 0; i < soups; i++) {
+		settled += search->results[i].period > 0;
+	}
+
+	double seconds = (double)(end.tv_sec - start.tv_sec) +
+		(double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	fprintf(stderr, "%llu soups in %.3f seconds using the %s kernel, "
+		"%llu settled\n", soups, seconds, getLifeKernel(), settled);
+	fprintf(stderr, "%.1f soups/s, %.1f soups/s per thread\n",
+		(double)soups / seconds, (double)soups / seconds / threads);
+	(void)fflush(NULL);
+
+	destroySoupSearch(search);
+}
+
+
+/**
+ * Run generations generations of the subdomain of the rank of transport,
+ * on a grid of ranksX by ranksY, starting with cells live at random with
+ * the chance density, and print how long that took.
+ *
+ * @Return false if the subdomain could not be created or lost its
+ * neighbours, with the population it ended with in population otherwise
+ */
+static boolean runRank(LifeTransport *transport, int ranksX, int ranksY,
+		       int boardSize, unsigned long long generations,
+		       uint64_t seed, double density,
+		       unsigned long long *population)
+{
+	struct timespec start;
+	struct timespec end;
+
+	LifeDomain *domain = createDomain(boardSize, ranksX, ranksY, transport);
+	if (!domain) {
+		printf("Rank %d could not create a subdomain of %d, the side "
+		       "has to be a multiple of 64.\n", transport->rank,
+		       boardSize);
+		(void)fflush(NULL);
+		return false;
+	}
+	seedDomain(domain, seed, density);
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &start);
+	unsigned long long i;
+	boolean success = true;
+	for (i = 0; i < generations && success; i++) {
+		success = stepDomain(domain);
+	}
+	(void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (double)(end.tv_sec - start.tv_sec) +
+		(double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	*population = countDomain(domain);
+	if (success) {
+		printf("rank %d: %llu generations in %.3f seconds, %.4g cell "
+		       "updates/s, population %llu\n", transport->rank,
+		       generations, seconds, (double)boardSize * boardSize *
+		       generations / seconds, *population);
+	} else {
+		printf("Rank %d stopped at generation %llu.\n",
+		       transport->rank, i);
+	}
+	(void)fflush(NULL);
+	destroyDomain(domain);
+
+	return success;
+}
+
+
+/**
+ * Run a board of ranksX by ranksY subdomains of boardSize for generations
+ * generations, starting from seed and density. With a rank, only that one is run,
+ * connected to the others over TCP at addresses; without, all of them are
+ * forked off here and connected over TCP if there are addresses and
+ * through shared memory if not, and the populations are added up at the
+ * end.
+ */
+static void runDistributed(int ranksX, int ranksY, int boardSize,
+			   unsigned long long generations, uint64_t seed,
+			   double density, const char *addresses, int rank)
+{
+	int ranks = ranksX * ranksY;
+	int neighbours[LIFE_DIRECTIONS];
+	LifeTransport *transport = NULL;
+	unsigned long long population = 0;
+
+	if (rank >= ranks) {
+		printf("Rank %d is not on a grid of %dx%d, exiting.\n", rank,
+		       ranksX, ranksY);
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	if (rank >= 0) {
+		findDomainNeighbours(rank, ranksX, ranksY, neighbours);
+		transport = createTcpTransport(rank, addresses, neighbours,
+					       LIFE_DIRECTIONS);
+		if (!transport || transport->ranks != ranks) {
+			printf("Not possible to connect rank %d to the others, "
+			       "exiting.\n", rank);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		boolean success = runRank(transport, ranksX, ranksY, boardSize,
+					  generations, seed, density,
+					  &population);
+		destroyTransport(transport);
+		if (!success) {
+			exit(EXIT_FAILURE);
+		}
+		return;
+	}
+
+	// the children hand back their populations through shared memory.
+	size_t size = sizeof(unsigned long long) * (size_t)ranks;
+	unsigned long long *populations = (unsigned long long *)mmap(NULL, size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (populations == MAP_FAILED) {
+		printf("Not possible to map memory for %d ranks, exiting.\n",
+		       ranks);
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+	if (!addresses) {
+		transport = createSharedTransport(ranks, sizeof(uint64_t) *
+						  (size_t)(boardSize / 64));
+		if (!transport) {
+			printf("Not possible to map memory for %d ranks, "
+			       "exiting.\n", ranks);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	struct timespec start;
+	struct timespec end;
+	(void)fflush(NULL);
+	(void)clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < ranks; i++) {
+		pid_t child = fork();
+		if (child < 0) {
+			printf("Not possible to start rank %d, exiting.\n", i);
+			(void)fflush(NULL);
+			exit(EXIT_FAILURE);
+		}
+		if (child > 0) {
+			continue;
+		}
+
+		if (transport) {
+			transport->rank = i;
+		} else {
+			findDomainNeighbours(i, ranksX, ranksY, neighbours);
+			transport = createTcpTransport(i, addresses, neighbours,
+						       LIFE_DIRECTIONS);
+		}
+		boolean success = transport && transport->ranks == ranks &&
+			runRank(transport, ranksX, ranksY, boardSize,
+				generations, seed, density, &populations[i]);
+		destroyTransport(transport);
+		_exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// every rank has to have made it, or the board is not whole.
+	boolean success = true;
+	for (int i = 0; i < ranks; i++) {
+		int status = 0;
+		if (wait(&status) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status) != EXIT_SUCCESS) {
+			success = false;
+		}
+	}
+	(void)clock_gettime(CLOCK_MONOTONIC, &end);
+	destroyTransport(transport);
+
+	for (int i = 0; i < ranks; i++) {
+		population += populations[i];
+	}
+	(void)munmap(populations, size);
+	if (!success) {
+		printf("Not all ranks made it to generation %llu, exiting.\n",
+		       generations);
+		(void)fflush(NULL);
+		exit(EXIT_FAILURE);
+	}
+
+	double seconds = (double)(end.tv_sec - start.tv_sec) +
+		(double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%llu generations of %dx%d cells on %dx%d ranks in %.3f "
+	       "seconds over %s\n", generations, boardSize * ranksX,
+	       boardSize * ranksY, ranksX, ranksY, seconds,
+	       addresses ? "TCP" : "shared memory");
+	printf("%.4g cell updates/s, population %llu\n",
+	       (double)boardSize * boardSize * ranks * generations / seconds,
+	       population);
+	(void)fflush(NULL);
+}
+
+/**
+ * Wait for the checkpoint being written, if any, then write the board as
+ * it is now in its place.
+ */
+static void finishCheckpoint(LifeCheckpoint *checkpoint, const char *path,
+			     unsigned long long generation)
+{
+	if (!checkpoint) {
+		return;
+	}
+
+	destroyCheckpoint(checkpoint);
+	if (!saveSnapshot(board, generation, &lifeRule, path)) {
+		printf("Not possible to write a snapshot to %s.\n", path);
+		(void)fflush(NULL);
+	}
+}
+
+
+/**
+ * Write the board to path in the plaintext format, with a dot for every
+ * dead cell and an O for every live one.
+ */
+static boolean saveBoard(LifeBoard *lifeBoard, unsigned long long generation,
+			 const char *path)
+{
+	int n = lifeBoard->boardSize;
+	char *line = (char *)malloc((size_t)n + 1);
+	FILE *file = fopen(path, "w");
+	boolean ok = line != NULL && file != NULL;
+
+	if (ok) {
+		fprintf(file, "!Name: generation %llu\n", generation);
+		line[n] = '\n';
+		for (int y = 0; y < n; y++) {
+			const uint64_t *cells = lifeRow(lifeBoard, y);
+			for (int x = 0; x < n; x++) {
+				line[x] = (cells[x / 64] >> (x % 64)) & 1 ?
+					'O' : '.';
+			}
+			ok = ok && fwrite(line, 1, (size_t)n + 1, file) ==
+				(size_t)n + 1;
+		}
+	}
+
+	if (file != NULL && fclose(file) != 0) {
+		ok = false;
+	}
+	free(line);
+
+	return ok;
+}
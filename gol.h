@@ -26,15 +26,17 @@
 #include <GL/glfw.h>
 
 #include "gol_backend.h"
-#include "list.h"
+#include "gol_simulation.h"
+#include "gol_sparse.h"
 
 int running =    GL_TRUE;
-int step =       GL_FALSE;
-int simulation = GL_TRUE;
+unsigned long long jumpSize = 0;
 float sleepTime =   0.0f;
 float sleepFactor = 0.005f;
 float scaleFactor = 0.0f;
+int verbosity = 0;
 LifeBoard *board =  NULL;
-CircularList *clist = NULL;
+SparseBoard *sparse = NULL;
+LifeSimulation *lifeSimulation = NULL;
 
 #endif
@@ -0,0 +1,161 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "gol_arena.h"
+
+/* Only the pages that are touched have to be there. */
+#ifdef MAP_NORESERVE
+#define LAZY_PAGES MAP_NORESERVE
+#else
+#define LAZY_PAGES 0
+#endif
+
+boolean lifeHugePages = false;
+
+/**
+ * Round size up to a multiple of alignment, a power of two.
+ */
+static inline size_t alignUp(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * Map size bytes of zeroed memory, from huge pages if asked to and there
+ * are any.
+ *
+ * @Return the memory, or NULL
+ */
+static void *mapMemory(size_t size, boolean hugePages)
+{
+	void *memory = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+	if (hugePages) {
+		memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (memory == MAP_FAILED) {
+		memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			      MAP_PRIVATE | MAP_ANONYMOUS | LAZY_PAGES, -1, 0);
+#ifdef MADV_HUGEPAGE
+		if (memory != MAP_FAILED && hugePages) {
+			(void)madvise(memory, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	return memory == MAP_FAILED ? NULL : memory;
+}
+
+/**
+ * Create an arena that can hand out capacity bytes, counting what is lost
+ * to alignment. The arena itself is kept at the start of its memory.
+ *
+ * @Return the arena, or NULL if the memory could not be mapped
+ */
+LifeArena *createArena(size_t capacity)
+{
+	size_t header = alignUp(sizeof(LifeArena), LIFE_PAGE_SIZE);
+	boolean hugePages = lifeHugePages &&
+		header + capacity >= LIFE_HUGE_PAGE_SIZE;
+	size_t mapped = alignUp(header + capacity, hugePages ?
+				LIFE_HUGE_PAGE_SIZE : LIFE_PAGE_SIZE);
+
+	unsigned char *memory = (unsigned char *)mapMemory(mapped, hugePages);
+	if (memory == NULL) {
+		return NULL;
+	}
+
+	LifeArena *arena = (LifeArena *)memory;
+	arena->base = memory + header;
+	arena->capacity = mapped - header;
+	arena->used = 0;
+	arena->peak = 0;
+	arena->mapped = mapped;
+	arena->hugePages = hugePages;
+
+	return arena;
+}
+
+/**
+ * Unmap an arena and everything allocated from it.
+ */
+void destroyArena(LifeArena *arena)
+{
+	if (arena != NULL) {
+		(void)munmap(arena, arena->mapped);
+	}
+}
+
+/**
+ * Allocate size bytes aligned to alignment, a power of two. The bytes are
+ * zero unless they were handed out before the last reset or release.
+ *
+ * @Return the memory, or NULL if the arena is full
+ */
+void *allocateArena(LifeArena *arena, size_t size, size_t alignment)
+{
+	size_t offset = alignUp(arena->used, alignment);
+
+	if (offset > arena->capacity || size > arena->capacity - offset) {
+		return NULL;
+	}
+
+	arena->used = offset + size;
+	if (arena->used > arena->peak) {
+		arena->peak = arena->used;
+	}
+
+	return arena->base + offset;
+}
+
+/**
+ * Get a mark to release the arena back to, dropping everything allocated
+ * after it.
+ */
+size_t markArena(LifeArena *arena)
+{
+	return arena->used;
+}
+
+/**
+ * Drop everything allocated since mark was taken.
+ */
+void releaseArena(LifeArena *arena, size_t mark)
+{
+	if (mark < arena->used) {
+		arena->used = mark;
+	}
+}
+
+/**
+ * Drop everything allocated from the arena.
+ */
+void resetArena(LifeArena *arena)
+{
+	arena->used = 0;
+}
@@ -0,0 +1,67 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_ARENA_H_
+#define __GOL_ARENA_H_
+
+#include <stddef.h>
+
+#include "gol_backend.h"
+
+#define LIFE_CACHE_LINE     64
+#define LIFE_PAGE_SIZE      4096
+#define LIFE_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*
+ * A region of memory mapped in one piece up front, which allocations are
+ * cut from one after the other and never freed on their own. Instead the
+ * whole arena is reset, or released back to a mark taken earlier, at the
+ * cost of moving one offset. Memory that has not been handed out before
+ * is zero, since it comes straight from the system, and only takes up
+ * room once it is touched, so an arena can be made as large as it could
+ * ever need to be.
+ *
+ * With huge pages an arena of at least a huge page is backed by them if
+ * the system has any to spare, and asks for transparent ones otherwise,
+ * which cuts the TLB misses of walking a large board.
+ */
+typedef struct LifeArena
+{
+	unsigned char *base;
+	size_t capacity;
+	size_t used;
+	size_t peak;
+	size_t mapped;
+	boolean hugePages;
+} LifeArena;
+
+/* Whether arenas created from now on ask for huge pages. */
+extern boolean lifeHugePages;
+
+LifeArena *createArena(size_t);
+void destroyArena(LifeArena *);
+void *allocateArena(LifeArena *, size_t, size_t);
+size_t markArena(LifeArena *);
+void releaseArena(LifeArena *, size_t);
+void resetArena(LifeArena *);
+
+#endif
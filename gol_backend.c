@@ -20,39 +20,56 @@
  * THE SOFTWARE
  */
 
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "gol_arena.h"
 #include "gol_backend.h"
+#include "gol_kernel.h"
+#include "gol_workers.h"
+
+#define WORD_BITS  64
 
 /**
- *
- *
+ * Mask with the bits below bit n set.
  */
-boolean **createMatrix(int size)
+static inline uint64_t lowMask(int n)
 {
-	if (size <= 0) {
-		return NULL;
-	}
+	return n == 0 ? 0 : ~(uint64_t)0 >> (WORD_BITS - n);
+}
 
-	boolean **matrix = (boolean **)malloc(sizeof(boolean *) * size);
-	for (int i = 0; i < size; i++) {
-		matrix[i] = (boolean *)malloc(sizeof(boolean) * size);
-	}
+/**
+ * Bytes of a cell buffer for a board, including the guard rows and words.
+ */
+static inline size_t cellBytes(int boardSize, int stride)
+{
+	return sizeof(uint64_t) * (size_t)stride * (boardSize + 2);
+}
+
+/**
+ * Bytes of the arena of a board: the two cell buffers, each on pages of
+ * its own, and two of everything kept per tile, whether or not hashes and
+ * counts are ever turned on, since they only cost address space until
+ * they are.
+ */
+static size_t boardBytes(int boardSize, int stride, size_t tiles)
+{
+	size_t perTile = 1 + sizeof(uint64_t) + sizeof(LifeTileCounts);
 
-	return matrix;
+	return 2 * (cellBytes(boardSize, stride) + LIFE_PAGE_SIZE) +
+		2 * (tiles * perTile + 3 * LIFE_CACHE_LINE);
 }
-	
+
 /**
+ * Allocate zeroed, cache line aligned memory from the arena of the board.
  *
- *
+ * @Return the memory, or NULL if the arena is full
  */
-void destroyMatrix(boolean **matrix, int size)
+static void *allocateBoard(LifeBoard *lifeBoard, size_t size)
 {
-	for(int i = 0; i < size; i++) {
-		free(matrix[i]);
-	}
-
-	free(matrix);
+	return allocateArena(lifeBoard->arena, size, LIFE_CACHE_LINE);
 }
 
 /**
@@ -66,31 +83,163 @@ LifeBoard *createLifeBoard(int boardSize)
 	}
 
 	LifeBoard *lifeBoard = (LifeBoard *)malloc( sizeof(LifeBoard) );
-	lifeBoard->matrix = createMatrix(boardSize);
+	if (lifeBoard == NULL) {
+		return NULL;
+	}
+
+	// room for the cells plus the guard word on each side, rounded up
+	// to whole cache lines.
+	int words = (boardSize + WORD_BITS - 1) / WORD_BITS;
+	int lineWords = LIFE_CACHE_LINE / sizeof(uint64_t);
+	int stride = LIFE_ROW_OFFSET +
+		((words + 1 + lineWords - 1) / lineWords) * lineWords;
+
 	lifeBoard->boardSize = boardSize;
+	lifeBoard->words = words;
+	lifeBoard->stride = stride;
+	lifeBoard->workers = NULL;
+	lifeBoard->topology = LIFE_TORUS;
+	lifeBoard->tilesX = (words + LIFE_TILE_WORDS - 1) / LIFE_TILE_WORDS;
+	lifeBoard->tilesY = (boardSize + LIFE_TILE_ROWS - 1) / LIFE_TILE_ROWS;
+	lifeBoard->tileHashes = NULL;
+	lifeBoard->nextTileHashes = NULL;
+	lifeBoard->tileCounts = NULL;
+	lifeBoard->nextTileCounts = NULL;
+	lifeBoard->scratch = NULL;
+
+	// everything the board keeps comes out of one mapping, freshly zeroed.
+	size_t tiles = (size_t)lifeBoard->tilesX * lifeBoard->tilesY;
+	lifeBoard->arena = createArena(boardBytes(boardSize, stride, tiles));
+	if (lifeBoard->arena == NULL) {
+		free(lifeBoard);
+		return NULL;
+	}
+
+	size_t bytes = cellBytes(boardSize, stride);
+	uint64_t *memory = (uint64_t *)allocateArena(lifeBoard->arena, bytes,
+						     LIFE_PAGE_SIZE);
+	uint64_t *nextMemory = (uint64_t *)allocateArena(lifeBoard->arena,
+							 bytes, LIFE_PAGE_SIZE);
+	lifeBoard->changed = (unsigned char *)allocateBoard(lifeBoard, tiles);
+	lifeBoard->nextChanged = (unsigned char *)allocateBoard(lifeBoard,
+								tiles);
+	lifeBoard->cells = memory + stride + LIFE_ROW_OFFSET;
+	lifeBoard->nextCells = nextMemory + stride + LIFE_ROW_OFFSET;
+
+	// nothing has been calculated yet.
+	markBoardChanged(lifeBoard);
 
 	return lifeBoard;
 }
 
-void randomizeBoard(LifeBoard *lifeBoard)
+/**
+ * Turn a density into the chance of a live cell in 1 / 2^LIFE_DENSITY_BITS.
+ */
+static uint32_t densityLevel(double density)
 {
-	if (lifeBoard == NULL) {
+	if (!(density > 0.0)) {
+		return 0;
+	}
+	if (density >= 1.0) {
+		return 1U << LIFE_DENSITY_BITS;
+	}
+
+	return (uint32_t)(density * (1U << LIFE_DENSITY_BITS) + 0.5);
+}
+
+/**
+ * Fill count words with random cells, live with the chance density, the
+ * first word being number index of whatever they are part of. Each word
+ * only depends on seed and its number, so they can be filled in any order
+ * and by any thread.
+ *
+ * A word of cells live with chance 1/2 is a single random word. Any other
+ * chance is built up from its binary digits, lowest first: OR-ing in
+ * another random word for a one halves the chance of a dead cell, and
+ * AND-ing in one for a zero halves the chance of a live cell. Each pass
+ * runs over the whole row, with nothing carried from word to word, so the
+ * compiler is free to vectorise it.
+ */
+void randomizeRow(uint64_t *cells, int count, uint64_t seed, uint64_t index,
+		  double density)
+{
+	uint32_t level = densityLevel(density);
+
+	if (level == 0 || level == 1U << LIFE_DENSITY_BITS) {
+		(void)memset(cells, level ? 0xff : 0x0,
+			     sizeof(uint64_t) * (size_t)count);
 		return;
 	}
 
-	int boardSize = lifeBoard->boardSize;
+	// the trailing zeros would only AND into a row of dead cells.
+	int bit = __builtin_ctz(level);
+	uint64_t counter = index * LIFE_DENSITY_BITS + (uint64_t)bit;
+	for (int w = 0; w < count; w++) {
+		cells[w] = randomWord(seed, counter +
+				      (uint64_t)w * LIFE_DENSITY_BITS);
+	}
 
-	// Create a random initialisated board.
-	for (int x = 0; x < boardSize; x++) {
-		for (int y = 0; y < boardSize; y++) {
-#ifdef __APPLE__
-			lifeBoard->matrix[x][y] = arc4random() % 2;
-#else
-			lifeBoard->matrix[x][y] = random() % 2;
-#endif
+	while (++bit < LIFE_DENSITY_BITS) {
+		counter++;
+		if (level & (1U << bit)) {
+			for (int w = 0; w < count; w++) {
+				cells[w] |= randomWord(seed, counter +
+					(uint64_t)w * LIFE_DENSITY_BITS);
+			}
+		} else {
+			for (int w = 0; w < count; w++) {
+				cells[w] &= randomWord(seed, counter +
+					(uint64_t)w * LIFE_DENSITY_BITS);
+			}
 		}
 	}
+}
+
+/* What the threads filling the board in all need to know. */
+typedef struct RandomBoard
+{
+	LifeBoard *lifeBoard;
+	uint64_t seed;
+	double density;
+} RandomBoard;
+
+/**
+ * Worker task filling one band of rows with random cells.
+ */
+static void randomizeBand(void *arg, int index, int count)
+{
+	RandomBoard *fill = (RandomBoard *)arg;
+	LifeBoard *lifeBoard = fill->lifeBoard;
+	long boardSize = lifeBoard->boardSize;
+	int words = lifeBoard->words;
+	uint64_t tail = lowMask((int)(boardSize % WORD_BITS));
 
+	for (long y = boardSize * index / count;
+	     y < boardSize * (index + 1) / count; y++) {
+		uint64_t *row = lifeRow(lifeBoard, (int)y);
+		randomizeRow(row, words, fill->seed, (uint64_t)y * words,
+			     fill->density);
+		if (tail) {
+			row[words - 1] &= tail;
+		}
+	}
+}
+
+/**
+ * Fill the board with random cells, live with the chance density, spread
+ * over the workers of the board if it has any. The same seed always gives
+ * the same board, however many workers there are.
+ */
+void randomizeBoard(LifeBoard *lifeBoard, uint64_t seed, double density)
+{
+	if (lifeBoard == NULL) {
+		return;
+	}
+
+	RandomBoard fill = { lifeBoard, seed, density };
+	runWorkerPool(lifeBoard->workers, &randomizeBand, &fill);
+
+	markBoardChanged(lifeBoard);
 }
 
 	
@@ -104,7 +253,8 @@ void destroyLifeBoard(LifeBoard *lifeBoard)
 		return;
 	}
 
-	destroyMatrix(lifeBoard->matrix, lifeBoard->boardSize);
+	destroyArena(lifeBoard->arena);
+	destroyArena(lifeBoard->scratch);
 	free(lifeBoard);
 }
 	
@@ -124,7 +274,8 @@ boolean getCell(LifeBoard *lifeBoard, int x, int y)
 	boolean yOk = (y >= 0) && (y < lifeBoard->boardSize) ? true : false;
 
 	if (xOk && yOk) {
-		return lifeBoard->matrix[x][y];
+		uint64_t word = lifeRow(lifeBoard, y)[x / WORD_BITS];
+		return (word >> (x % WORD_BITS)) & 1 ? true : false;
 	}
 
 	else {
@@ -148,7 +299,11 @@ boolean setCell(LifeBoard *lifeBoard, int x, int y, boolean state)
 	boolean yOk = (y >= 0) && (y < lifeBoard->boardSize) ? true : false;
 
 	if (xOk && yOk) {
-		lifeBoard->matrix[x][y] = state;
+		uint64_t *word = &lifeRow(lifeBoard, y)[x / WORD_BITS];
+		uint64_t bit = (uint64_t)1 << (x % WORD_BITS);
+		*word = state ? (*word | bit) : (*word & ~bit);
+		lifeBoard->changed[(y / LIFE_TILE_ROWS) * lifeBoard->tilesX +
+				   x / WORD_BITS / LIFE_TILE_WORDS] = 2;
 		return true;
 	}
 
@@ -157,6 +312,404 @@ boolean setCell(LifeBoard *lifeBoard, int x, int y, boolean state)
 	}
 }
 	
+/**
+ * Flag every tile as changed, so the whole board is calculated in the next
+ * generation. Needed after writing to the cells other than through setCell.
+ */
+void markBoardChanged(LifeBoard *lifeBoard)
+{
+	if (lifeBoard == NULL) {
+		return;
+	}
+
+	(void)memset(lifeBoard->changed, 2,
+		     (size_t)lifeBoard->tilesX * lifeBoard->tilesY);
+}
+
+/*
+ * Keys for the words of a tile, set up once when hashing is first turned
+ * on, however many boards turn it on at the same time.
+ */
+static uint64_t tileKeys[LIFE_TILE_ROWS * LIFE_TILE_WORDS];
+static pthread_once_t tileKeysOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Hash tile (tx, ty) of one of the buffers of the board. Each word is
+ * added with the key for its place in the tile and the halves multiplied,
+ * which only takes 32 bit multiplies the compiler can vectorise, and the
+ * sum is mixed with the number of the tile.
+ */
+static uint64_t hashTile(LifeBoard *lifeBoard, const uint64_t *cells,
+			 int tx, int ty)
+{
+	int w0 = tx * LIFE_TILE_WORDS;
+	int y0 = ty * LIFE_TILE_ROWS;
+	int width = lifeBoard->words - w0;
+	int height = lifeBoard->boardSize - y0;
+	uint64_t sum = 0;
+
+	if (width > LIFE_TILE_WORDS) {
+		width = LIFE_TILE_WORDS;
+	}
+	if (height > LIFE_TILE_ROWS) {
+		height = LIFE_TILE_ROWS;
+	}
+
+	for (int y = 0; y < height; y++) {
+		const uint64_t *row = cells + (long)(y0 + y) * lifeBoard->stride +
+			w0;
+		const uint64_t *keys = tileKeys + y * LIFE_TILE_WORDS;
+		for (int w = 0; w < width; w++) {
+			uint64_t word = row[w];
+			sum += (uint64_t)(uint32_t)(word + keys[w]) *
+				(uint32_t)((word >> 32) + (keys[w] >> 32));
+		}
+	}
+
+	// the last word may have a guard cell past the edge, take it out.
+	int tail = lifeBoard->boardSize % WORD_BITS;
+	if (tail && w0 + width == lifeBoard->words) {
+		int w = width - 1;
+		for (int y = 0; y < height; y++) {
+			uint64_t word = cells[(long)(y0 + y) * lifeBoard->stride +
+					      w0 + w];
+			uint64_t key = tileKeys[y * LIFE_TILE_WORDS + w];
+			uint64_t kept = word & lowMask(tail);
+			sum -= (uint64_t)(uint32_t)(word + key) *
+				(uint32_t)((word >> 32) + (key >> 32));
+			sum += (uint64_t)(uint32_t)(kept + key) *
+				(uint32_t)((kept >> 32) + (key >> 32));
+		}
+	}
+
+	return mixWord(sum ^ mixWord((uint64_t)ty * lifeBoard->tilesX + tx));
+}
+
+/**
+ * Hash the tiles of tile row ty that were written from outside in the
+ * front buffer, and those that changed in the back buffer.
+ */
+static void hashTiles(LifeBoard *lifeBoard, int ty)
+{
+	int tilesX = lifeBoard->tilesX;
+	long first = (long)ty * tilesX;
+
+	for (int tx = 0; tx < tilesX; tx++) {
+		if (lifeBoard->changed[first + tx] > 1) {
+			lifeBoard->tileHashes[first + tx] =
+				hashTile(lifeBoard, lifeBoard->cells, tx, ty);
+		}
+		if (lifeBoard->nextChanged[first + tx]) {
+			lifeBoard->nextTileHashes[first + tx] =
+				hashTile(lifeBoard, lifeBoard->nextCells, tx, ty);
+		}
+	}
+}
+
+/**
+ * Set up the keys for the words of a tile.
+ */
+static void setupTileKeys(void)
+{
+	for (int i = 0; i < LIFE_TILE_ROWS * LIFE_TILE_WORDS; i++) {
+		tileKeys[i] = randomWord(0, (uint64_t)i);
+	}
+}
+
+/**
+ * Start keeping a hash of the board, to tell generations apart by.
+ *
+ * @Return false if out of memory
+ */
+boolean enableBoardHash(LifeBoard *lifeBoard)
+{
+	if (lifeBoard == NULL) {
+		return false;
+	}
+	if (lifeBoard->tileHashes != NULL) {
+		return true;
+	}
+
+	(void)pthread_once(&tileKeysOnce, &setupTileKeys);
+
+	size_t tiles = (size_t)lifeBoard->tilesX * lifeBoard->tilesY;
+	uint64_t *tileHashes =
+		(uint64_t *)allocateBoard(lifeBoard, sizeof(uint64_t) * tiles);
+	uint64_t *nextTileHashes =
+		(uint64_t *)allocateBoard(lifeBoard, sizeof(uint64_t) * tiles);
+	if (tileHashes == NULL || nextTileHashes == NULL) {
+		return false;
+	}
+	lifeBoard->tileHashes = tileHashes;
+	lifeBoard->nextTileHashes = nextTileHashes;
+
+	// the back buffer keeps the tiles that do not change next time.
+	for (int ty = 0; ty < lifeBoard->tilesY; ty++) {
+		for (int tx = 0; tx < lifeBoard->tilesX; tx++) {
+			long t = (long)ty * lifeBoard->tilesX + tx;
+			lifeBoard->tileHashes[t] =
+				hashTile(lifeBoard, lifeBoard->cells, tx, ty);
+			lifeBoard->nextTileHashes[t] =
+				hashTile(lifeBoard, lifeBoard->nextCells, tx, ty);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Get the hash of the board, which has to have hashing turned on.
+ *
+ * @Return the XOR of the hashes of the tiles, or 0 without hashing
+ */
+uint64_t getBoardHash(LifeBoard *lifeBoard)
+{
+	if (lifeBoard == NULL || lifeBoard->tileHashes == NULL) {
+		return 0;
+	}
+
+	uint64_t hash = 0;
+	for (int ty = 0; ty < lifeBoard->tilesY; ty++) {
+		for (int tx = 0; tx < lifeBoard->tilesX; tx++) {
+			long t = (long)ty * lifeBoard->tilesX + tx;
+			if (lifeBoard->changed[t] > 1) {
+				lifeBoard->tileHashes[t] =
+					hashTile(lifeBoard, lifeBoard->cells,
+						 tx, ty);
+			}
+			hash ^= lifeBoard->tileHashes[t];
+		}
+	}
+
+	return hash;
+}
+
+/**
+ * Mask with the cells of word w of a row set, which leaves out the guard
+ * cell past the edge of the board in the last word.
+ */
+static inline uint64_t cellMask(const LifeBoard *lifeBoard, int w)
+{
+	int tail = lifeBoard->boardSize % WORD_BITS;
+
+	return tail && w == lifeBoard->words - 1 ? lowMask(tail) : ~(uint64_t)0;
+}
+
+/**
+ * Count the live cells of tile (tx, ty) of the front buffer.
+ */
+static unsigned long long countTile(LifeBoard *lifeBoard, int tx, int ty)
+{
+	int w0 = tx * LIFE_TILE_WORDS;
+	int y0 = ty * LIFE_TILE_ROWS;
+	int w1 = w0 + LIFE_TILE_WORDS;
+	int y1 = y0 + LIFE_TILE_ROWS;
+	unsigned long long population = 0;
+
+	if (w1 > lifeBoard->words) {
+		w1 = lifeBoard->words;
+	}
+	if (y1 > lifeBoard->boardSize) {
+		y1 = lifeBoard->boardSize;
+	}
+
+	for (int y = y0; y < y1; y++) {
+		const uint64_t *row = lifeRow(lifeBoard, y);
+		for (int w = w0; w < w1; w++) {
+			population += (unsigned long long)__builtin_popcountll(
+				row[w] & cellMask(lifeBoard, w));
+		}
+	}
+
+	return population;
+}
+
+/**
+ * Count the tiles of tile row ty written from outside in the front buffer
+ * again, as their cells were not born and did not die.
+ */
+static void recountTiles(LifeBoard *lifeBoard, int ty)
+{
+	int tilesX = lifeBoard->tilesX;
+	long first = (long)ty * tilesX;
+
+	for (int tx = 0; tx < tilesX; tx++) {
+		if (lifeBoard->changed[first + tx] > 1) {
+			LifeTileCounts *tile = &lifeBoard->tileCounts[first + tx];
+			tile->population = countTile(lifeBoard, tx, ty);
+			tile->births = 0;
+			tile->deaths = 0;
+		}
+	}
+}
+
+/**
+ * Start counting the cells of the board every generation. Every tile is
+ * calculated in the next two generations, so both buffers are counted.
+ *
+ * @Return false if out of memory
+ */
+boolean enableBoardStatistics(LifeBoard *lifeBoard)
+{
+	if (lifeBoard == NULL) {
+		return false;
+	}
+	if (lifeBoard->tileCounts != NULL) {
+		return true;
+	}
+
+	size_t tiles = (size_t)lifeBoard->tilesX * lifeBoard->tilesY;
+	LifeTileCounts *tileCounts = (LifeTileCounts *)allocateBoard(
+		lifeBoard, sizeof(LifeTileCounts) * tiles);
+	LifeTileCounts *nextTileCounts = (LifeTileCounts *)allocateBoard(
+		lifeBoard, sizeof(LifeTileCounts) * tiles);
+	if (tileCounts == NULL || nextTileCounts == NULL) {
+		return false;
+	}
+	lifeBoard->tileCounts = tileCounts;
+	lifeBoard->nextTileCounts = nextTileCounts;
+
+	markBoardChanged(lifeBoard);
+
+	return true;
+}
+
+/**
+ * @Return whether row y has a live cell
+ */
+static boolean rowAlive(LifeBoard *lifeBoard, int y)
+{
+	const uint64_t *row = lifeRow(lifeBoard, y);
+	uint64_t cells = 0;
+
+	for (int w = 0; w < lifeBoard->words; w++) {
+		cells |= row[w] & cellMask(lifeBoard, w);
+	}
+
+	return cells != 0;
+}
+
+/**
+ * @Return the OR of word w of the rows y0 up to y1
+ */
+static uint64_t columnCells(LifeBoard *lifeBoard, int w, int y0, int y1)
+{
+	uint64_t cells = 0;
+
+	for (int y = y0; y < y1; y++) {
+		cells |= lifeRow(lifeBoard, y)[w];
+	}
+
+	return cells & cellMask(lifeBoard, w);
+}
+
+/**
+ * Add up the counts of the tiles for the generation last calculated, which
+ * are all zero before statistics were turned on. The bounding box is not
+ * kept per tile, but looked for in the rows and columns of the outermost
+ * tiles with live cells, which only reads a few words of each row.
+ */
+void getBoardStatistics(LifeBoard *lifeBoard, LifeStatistics *statistics)
+{
+	(void)memset(statistics, 0x0, sizeof(LifeStatistics));
+	statistics->minX = statistics->minY = INT_MAX;
+	statistics->maxX = statistics->maxY = -1;
+
+	if (lifeBoard == NULL || lifeBoard->tileCounts == NULL) {
+		return;
+	}
+
+	int tx0 = INT_MAX;
+	int ty0 = INT_MAX;
+	int tx1 = -1;
+	int ty1 = -1;
+	for (int ty = 0; ty < lifeBoard->tilesY; ty++) {
+		recountTiles(lifeBoard, ty);
+		for (int tx = 0; tx < lifeBoard->tilesX; tx++) {
+			const LifeTileCounts *tile = &lifeBoard->tileCounts[
+				(long)ty * lifeBoard->tilesX + tx];
+			statistics->population += tile->population;
+			statistics->births += tile->births;
+			statistics->deaths += tile->deaths;
+			if (tile->population == 0) {
+				continue;
+			}
+			tx0 = tx < tx0 ? tx : tx0;
+			tx1 = tx > tx1 ? tx : tx1;
+			ty0 = ty < ty0 ? ty : ty0;
+			ty1 = ty;
+		}
+	}
+	if (statistics->population == 0) {
+		return;
+	}
+
+	int y0 = ty0 * LIFE_TILE_ROWS;
+	int y1 = (ty1 + 1) * LIFE_TILE_ROWS;
+	if (y1 > lifeBoard->boardSize) {
+		y1 = lifeBoard->boardSize;
+	}
+	int w1 = (tx1 + 1) * LIFE_TILE_WORDS;
+	if (w1 > lifeBoard->words) {
+		w1 = lifeBoard->words;
+	}
+
+	int y = y0;
+	while (!rowAlive(lifeBoard, y)) {
+		y++;
+	}
+	statistics->minY = y;
+	y = y1 - 1;
+	while (!rowAlive(lifeBoard, y)) {
+		y--;
+	}
+	statistics->maxY = y;
+
+	int w = tx0 * LIFE_TILE_WORDS;
+	uint64_t cells;
+	while ((cells = columnCells(lifeBoard, w, y0, y1)) == 0) {
+		w++;
+	}
+	statistics->minX = w * WORD_BITS + __builtin_ctzll(cells);
+	w = w1 - 1;
+	while ((cells = columnCells(lifeBoard, w, y0, y1)) == 0) {
+		w--;
+	}
+	statistics->maxX = w * WORD_BITS + WORD_BITS - 1 -
+		__builtin_clzll(cells);
+}
+
+/**
+ * Write the statistics of the generation last calculated as a line of
+ * CSV, or the header line for generation 0.
+ */
+void writeBoardStatistics(FILE *file, LifeBoard *lifeBoard,
+			  unsigned long long generation)
+{
+	LifeStatistics statistics;
+
+	if (file == NULL) {
+		return;
+	}
+	if (generation == 0) {
+		fprintf(file, "generation,population,births,deaths,changed,"
+			"min x,min y,max x,max y\n");
+		return;
+	}
+
+	getBoardStatistics(lifeBoard, &statistics);
+	if (statistics.population == 0) {
+		fprintf(file, "%llu,0,%llu,%llu,%llu,,,,\n", generation,
+			statistics.births, statistics.deaths,
+			statistics.births + statistics.deaths);
+		return;
+	}
+	fprintf(file, "%llu,%llu,%llu,%llu,%llu,%d,%d,%d,%d\n", generation,
+		statistics.population, statistics.births, statistics.deaths,
+		statistics.births + statistics.deaths, statistics.minX,
+		statistics.minY, statistics.maxX, statistics.maxY);
+}
+
 /*		
  * The coordinates of the cells that live around the cell at (x,y)
  * 		
@@ -180,209 +733,639 @@ boolean setCell(LifeBoard *lifeBoard, int x, int y, boolean state)
  */	
 
 /**
- * Calcuate the next life cycle for all the cells
+ * Fill in the guards with dead cells, for a board with hard edges.
  */
-void calculateLife(LifeBoard *lifeBoard)
-{		
-	if (lifeBoard == NULL) {
-		return;
+static void clearGuards(LifeBoard *lifeBoard)
+{
+	int boardSize = lifeBoard->boardSize;
+	int last = boardSize / WORD_BITS;
+	uint64_t keep = lowMask(boardSize % WORD_BITS);
+
+	for (int y = 0; y < boardSize; y++) {
+		uint64_t *row = lifeRow(lifeBoard, y);
+		row[-1] = 0;
+		row[last] &= keep;
 	}
 
+	size_t rowSize = sizeof(uint64_t) * (lifeBoard->words + 2);
+	(void)memset(lifeRow(lifeBoard, -1) - 1, 0x0, rowSize);
+	(void)memset(lifeRow(lifeBoard, boardSize) - 1, 0x0, rowSize);
+}
+
+/**
+ * Fill in the guard bits on either side of a row of a board of boardSize
+ * with the cells from the other end of it.
+ */
+static inline void wrapRow(uint64_t *row, int boardSize)
+{
+	int max = boardSize - 1;
+	int last = boardSize / WORD_BITS;
+	int lastBit = boardSize % WORD_BITS;
+	uint64_t west = (row[max / WORD_BITS] >> (max % WORD_BITS)) & 1;
+	uint64_t east = row[0] & 1;
+
+	/* (-1, y) is (boardSize - 1, y) and (boardSize, y) is (0, y) */
+	row[-1] = west << (WORD_BITS - 1);
+	row[last] = (row[last] & lowMask(lastBit)) | (east << lastBit);
+}
+
+/**
+ * Fill in the guards with the cells from the opposite edge, so the board
+ * is projected onto a torus.
+ */
+static void wrapGuards(LifeBoard *lifeBoard)
+{
 	int boardSize = lifeBoard->boardSize;
-	boolean **newBoard = createMatrix(boardSize);
-	
-	for (int x = 0; x < boardSize; x++) {
-		for (int y = 0; y < boardSize; y++) {
-			
-			int count = 0;		
-				
-			/* check that we stay inside the game matrix */
-			boolean xOk = 
-				(x - 1 >= 0) && (x + 1 < boardSize) ? true : false;
-			boolean yOk = 
-				(y - 1 >= 0) && (y + 1 < boardSize) ? true : false;
-
-			if (xOk && yOk && lifeBoard->matrix[x - 1][y + 1]) {
-				count++;
-			}
-			
-			if (yOk && lifeBoard->matrix[x][y + 1]) {
-				    count++;
-			}
-			
-			if (xOk && yOk && lifeBoard->matrix[x + 1][y + 1]) {
-				count++;
-			}
-			
-			if (xOk && lifeBoard->matrix[x - 1][y]) {
-				count++;
-			}
-			
-			if (xOk && lifeBoard->matrix[x + 1][y]) {
-				count++;
-			}
-			
-			if (xOk && yOk && lifeBoard->matrix[x - 1][y - 1]) {
-				count++;
-			}
-			
-			if (yOk && lifeBoard->matrix[x][y - 1]) {
-				count++;
+	int max = boardSize - 1;
+
+	for (int y = 0; y < boardSize; y++) {
+		wrapRow(lifeRow(lifeBoard, y), boardSize);
+	}
+
+	/* and the same for the rows, corners included */
+	size_t rowSize = sizeof(uint64_t) * (lifeBoard->words + 2);
+	(void)memcpy(lifeRow(lifeBoard, -1) - 1, lifeRow(lifeBoard, max) - 1,
+		     rowSize);
+	(void)memcpy(lifeRow(lifeBoard, boardSize) - 1, lifeRow(lifeBoard, 0) - 1,
+		     rowSize);
+}
+
+/**
+ * Fill in the guard row at to with the cells of row from, guards included,
+ * in reverse, so that (x, -1) is (boardSize - 1 - x, boardSize - 1).
+ */
+static void flipRow(uint64_t *to, const uint64_t *from, int words,
+		    int boardSize)
+{
+	int max = boardSize - 1;
+
+	// cell x is bit x % 64 of word x / 64, from -1 to boardSize.
+	(void)memset(to - 1, 0x0, sizeof(uint64_t) * (words + 2));
+	for (int x = -1; x <= boardSize; x++) {
+		int i = max - x + WORD_BITS;
+		int o = x + WORD_BITS;
+		uint64_t cell = (from[i / WORD_BITS - 1] >> (i % WORD_BITS)) & 1;
+		to[o / WORD_BITS - 1] |= cell << (o % WORD_BITS);
+	}
+}
+
+/**
+ * Fill in the guards with the cells from the opposite edge left and right,
+ * and from the opposite edge flipped over at the top and bottom, so the
+ * board is projected onto a Klein bottle.
+ */
+static void twistGuards(LifeBoard *lifeBoard)
+{
+	int boardSize = lifeBoard->boardSize;
+	int words = lifeBoard->words;
+
+	for (int y = 0; y < boardSize; y++) {
+		wrapRow(lifeRow(lifeBoard, y), boardSize);
+	}
+
+	flipRow(lifeRow(lifeBoard, -1), lifeRow(lifeBoard, boardSize - 1),
+		words, boardSize);
+	flipRow(lifeRow(lifeBoard, boardSize), lifeRow(lifeBoard, 0), words,
+		boardSize);
+}
+
+/**
+ * Fill in the guards with the cells along the edges themselves, so the
+ * board is mirrored at its edges.
+ */
+static void mirrorGuards(LifeBoard *lifeBoard)
+{
+	int boardSize = lifeBoard->boardSize;
+	int max = boardSize - 1;
+	int last = boardSize / WORD_BITS;
+	int lastBit = boardSize % WORD_BITS;
+
+	for (int y = 0; y < boardSize; y++) {
+		uint64_t *row = lifeRow(lifeBoard, y);
+		uint64_t west = row[0] & 1;
+		uint64_t east = (row[max / WORD_BITS] >> (max % WORD_BITS)) & 1;
+
+		/* (-1, y) is (0, y) and (boardSize, y) is (boardSize - 1, y) */
+		row[-1] = west << (WORD_BITS - 1);
+		row[last] = (row[last] & lowMask(lastBit)) | (east << lastBit);
+	}
+
+	size_t rowSize = sizeof(uint64_t) * (lifeBoard->words + 2);
+	(void)memcpy(lifeRow(lifeBoard, -1) - 1, lifeRow(lifeBoard, 0) - 1,
+		     rowSize);
+	(void)memcpy(lifeRow(lifeBoard, boardSize) - 1,
+		     lifeRow(lifeBoard, max) - 1, rowSize);
+}
+
+/**
+ * Flag the tiles in tile row ty that have to be calculated, that is the
+ * ones where the tile itself or one of its neighbours changed. Beyond the
+ * top and bottom of a Klein bottle the tiles are flipped over, and do not
+ * line up with the ones here, so a change anywhere in the tile row there
+ * counts for all of them.
+ */
+static void findActiveTiles(LifeBoard *lifeBoard, int ty,
+			    unsigned char *active)
+{
+	int tilesX = lifeBoard->tilesX;
+	int tilesY = lifeBoard->tilesY;
+	LifeTopology topology = lifeBoard->topology;
+	boolean wraps = topology == LIFE_TORUS ||
+		topology == LIFE_KLEIN_BOTTLE;
+	unsigned char column[tilesX];
+
+	// changes in the tile rows above, at and below ty ...
+	(void)memcpy(column, lifeBoard->changed + (long)ty * tilesX, tilesX);
+	for (int dy = -1; dy <= 1; dy += 2) {
+		int ny = ty + dy;
+		if (wraps) {
+			ny = (ny + tilesY) % tilesY;
+		} else if (ny < 0 || ny >= tilesY) {
+			continue;
+		}
+
+		unsigned char *changed = lifeBoard->changed + (long)ny * tilesX;
+		if (topology == LIFE_KLEIN_BOTTLE && ny != ty + dy) {
+			unsigned char any = 0;
+			for (int tx = 0; tx < tilesX; tx++) {
+				any |= changed[tx];
 			}
-			
-			if (xOk && yOk && lifeBoard->matrix[x + 1][y - 1]) {
-				count++;
+			for (int tx = 0; tx < tilesX; tx++) {
+				column[tx] |= any;
 			}
+			continue;
+		}
 
-			/*
-			  The rules for the game of life are :
-			  
-			  Any live cell with fewer than two neighbors dies of loneliness.
-			  Any live cell with more than three neighbors dies of crowding.
-			  Any dead cell with exactly three neighbors comes to life.
-			  Any live cell with two or three neighbors lives, unchanged, to the
-			  next generation.
-			*/					
-			
-			if (lifeBoard->matrix[x][y]) {
-				
-				if (count < 2) {
-					newBoard[x][y] = false;
+		for (int tx = 0; tx < tilesX; tx++) {
+			column[tx] |= changed[tx];
+		}
+	}
+
+	// ... spread to the tiles on either side.
+	for (int tx = 0; tx < tilesX; tx++) {
+		int west = tx - 1;
+		int east = tx + 1;
+		if (wraps) {
+			west = (west + tilesX) % tilesX;
+			east = east % tilesX;
+		}
+
+		active[tx] = column[tx] |
+			(west >= 0 ? column[west] : 0) |
+			(east < tilesX ? column[east] : 0);
+	}
+}
+
+/**
+ * Add up the counts of the words of the active tiles of tile row ty into
+ * the counts of the tiles. The cells that changed are the ones born and the
+ * ones that died, and the difference between those is how many more live
+ * cells there are than before.
+ */
+static void finishCounts(LifeBoard *lifeBoard, int ty,
+			 const unsigned char *active, const uint64_t *counts)
+{
+	int tilesX = lifeBoard->tilesX;
+	long first = (long)ty * tilesX;
+
+	for (int tx = 0; tx < tilesX; tx++) {
+		if (!active[tx]) {
+			continue;
+		}
+
+		const uint64_t *count = counts + tx * LIFE_COUNT_WORDS;
+		unsigned long long population = 0;
+		unsigned long long flips = 0;
+		for (int w = 0; w < LIFE_TILE_WORDS; w++) {
+			population += count[w];
+			flips += count[LIFE_TILE_WORDS + w];
+		}
+
+		LifeTileCounts *tile = &lifeBoard->nextTileCounts[first + tx];
+		tile->population = population;
+		tile->births = (flips + population -
+				lifeBoard->tileCounts[first + tx].population) / 2;
+		tile->deaths = flips - tile->births;
+	}
+}
+
+/**
+ * Calcuate the next generation of tile rows ty0 up to ty1 into the back
+ * buffer, skipping the tiles where nothing can have changed, and flag the
+ * tiles that did change.
+ */
+static void calculateTiles(LifeBoard *lifeBoard, int ty0, int ty1)
+{
+	int boardSize = lifeBoard->boardSize;
+	int words = lifeBoard->words;
+	int tilesX = lifeBoard->tilesX;
+	long stride = lifeBoard->stride;
+	uint64_t tail = lowMask(boardSize % WORD_BITS);
+	unsigned char active[tilesX];
+	boolean counting = lifeBoard->nextTileCounts != NULL;
+	uint64_t counts[counting ? tilesX * LIFE_COUNT_WORDS : 1];
+
+	// a partial last word is done on its own, so that it can be masked
+	// before it is compared.
+	int full = tail ? words - 1 : words;
+
+	for (int ty = ty0; ty < ty1; ty++) {
+		unsigned char *changed = lifeBoard->changed + (long)ty * tilesX;
+		unsigned char *next = lifeBoard->nextChanged + (long)ty * tilesX;
+		int y1 = (ty + 1) * LIFE_TILE_ROWS;
+
+		findActiveTiles(lifeBoard, ty, active);
+
+		// cells written from outside count as changed once more.
+		boolean any = false;
+		for (int tx = 0; tx < tilesX; tx++) {
+			next[tx] = changed[tx] > 1;
+			any |= active[tx];
+		}
+		if (!any) {
+			continue;
+		}
+
+		if (counting) {
+			recountTiles(lifeBoard, ty);
+			(void)memset(counts, 0x0, sizeof(counts));
+		}
+
+		for (int y = ty * LIFE_TILE_ROWS; y < y1 && y < boardSize; y++) {
+			const uint64_t *row = lifeRow(lifeBoard, y);
+			uint64_t *out = lifeBoard->nextCells + y * stride;
+
+			for (int tx = 0; tx < tilesX; ) {
+				if (!active[tx]) {
+					tx++;
+					continue;
 				}
-				
-				else if (count > 3) {
-					newBoard[x][y] = false;
+
+				// run the kernel over all the active tiles in a row
+				int first = tx;
+				while (tx < tilesX && active[tx]) {
+					tx++;
 				}
-				
-				else {
-					newBoard[x][y] = lifeBoard->matrix[x][y];
+				int w0 = first * LIFE_TILE_WORDS;
+				int w1 = tx * LIFE_TILE_WORDS;
+				if (w1 > full) {
+					w1 = full;
 				}
-				
-			}
-			
-			else {
-				
-				if (count == 3) {
-					newBoard[x][y] = true;
+
+				if (counting) {
+					lifeCountKernel(row - stride + w0,
+						row + w0, row + stride + w0,
+						out + w0, w1 - w0, next + first,
+						counts + first * LIFE_COUNT_WORDS);
+				} else {
+					lifeRowKernel(row - stride + w0,
+						row + w0, row + stride + w0,
+						out + w0, w1 - w0, next + first);
+				}
+
+				if (tx < tilesX || full == words) {
+					continue;
+				}
+
+				// the bits past the edge of the board have to stay dead.
+				uint64_t last = 0;
+				unsigned char ignored = 0;
+				lifeRowKernel(row - stride + full, row + full,
+					      row + stride + full, &last, 1,
+					      &ignored);
+				last &= tail;
+				if (last != out[full]) {
+					next[tilesX - 1] = 1;
 				}
-				
-				else {
-					newBoard[x][y] = false;
+				out[full] = last;
+
+				if (counting) {
+					uint64_t *count = counts +
+						(tilesX - 1) * LIFE_COUNT_WORDS +
+						full % LIFE_TILE_WORDS;
+					count[0] += (uint64_t)
+						__builtin_popcountll(last);
+					count[LIFE_TILE_WORDS] += (uint64_t)
+						__builtin_popcountll(last ^
+							(row[full] & tail));
 				}
-					
 			}
 		}
+
+		if (counting) {
+			finishCounts(lifeBoard, ty, active, counts);
+		}
+
+		if (lifeBoard->tileHashes != NULL) {
+			hashTiles(lifeBoard, ty);
+		}
 	}
-	
-	//destroyMatrix(lifeBoard->matrix, lifeBoard->boardSize);
-	lifeBoard->matrix = newBoard;
+}
+
+/**
+ * Worker task calculating one band of tile rows of the board.
+ */
+static void calculateBand(void *arg, int index, int count)
+{
+	LifeBoard *lifeBoard = (LifeBoard *)arg;
+	long tilesY = lifeBoard->tilesY;
 
+	calculateTiles(lifeBoard, (int)(tilesY * index / count),
+		       (int)(tilesY * (index + 1) / count));
 }
 
+/**
+ * Swap the buffers, and everything kept for each of them.
+ */
+static void swapBuffers(LifeBoard *lifeBoard)
+{
+	uint64_t *cells = lifeBoard->cells;
+	unsigned char *changed = lifeBoard->changed;
+	lifeBoard->cells = lifeBoard->nextCells;
+	lifeBoard->changed = lifeBoard->nextChanged;
+	lifeBoard->nextCells = cells;
+	lifeBoard->nextChanged = changed;
+
+	uint64_t *tileHashes = lifeBoard->tileHashes;
+	lifeBoard->tileHashes = lifeBoard->nextTileHashes;
+	lifeBoard->nextTileHashes = tileHashes;
+
+	LifeTileCounts *tileCounts = lifeBoard->tileCounts;
+	lifeBoard->tileCounts = lifeBoard->nextTileCounts;
+	lifeBoard->nextTileCounts = tileCounts;
+}
 
 /**
- * Calcuate the next life cycle for all the cells with the board projected onto a torus.
+ * Calcuate the next generation of the whole board from the guards that
+ * have been filled in, and swap it in.
  */
-void calculateLifeTorus(LifeBoard *LifeBoard)
-{		
+static void calculateBoard(LifeBoard *lifeBoard)
+{
+	runWorkerPool(lifeBoard->workers, &calculateBand, lifeBoard);
+	swapBuffers(lifeBoard);
+}
 
-	if (LifeBoard == NULL) {
+/**
+ * Swap in a next generation that was written to the back buffer from
+ * outside, by a kernel run over the rows directly. The tiles were not
+ * kept track of, so all of them count as changed.
+ */
+void swapLifeBoard(LifeBoard *lifeBoard)
+{
+	if (lifeBoard == NULL) {
 		return;
 	}
 
-	int boardSize = LifeBoard->boardSize;
-	boolean **newBoard = (boolean **)malloc(sizeof(boolean *) * boardSize);
-	
-	for (int i = 0; i < boardSize; i++) {
-		newBoard[i] = (boolean *)malloc(sizeof(boolean) * boardSize);
-	}
-
-	for (int x = 0; x < boardSize; x++) {
-		for (int y = 0; y < boardSize; y++) {
-			
-			int count = 0;		
-			
-			/* We need to map boardSize + 1 to 0 and -1 to boardSize */
-			int maxBoardSize = boardSize - 1;
-			
-			int xPlusOne =  (x + 1) > maxBoardSize ? 0 : (x + 1);
-			int xMinusOne = (x - 1) < 0 ? maxBoardSize : (x - 1);
-			int yPlusOne =  (y + 1) > maxBoardSize ? 0 : (y + 1);
-			int yMinusOne = (y - 1) < 0 ? maxBoardSize : (y - 1);
-			
-			if (LifeBoard->matrix[xMinusOne][yPlusOne]) {
-				count++;
-			}
-			
-			if (LifeBoard->matrix[x][yPlusOne]) {
-				count++;
-			}
+	swapBuffers(lifeBoard);
+	markBoardChanged(lifeBoard);
+}
 
-			if (LifeBoard->matrix[xPlusOne][yPlusOne]) {
-				count++;
-			}
+/**
+ * Switch the board to another topology; the cells along the edges then
+ * have other neighbours than last generation, so start over.
+ */
+static void setTopology(LifeBoard *lifeBoard, LifeTopology topology)
+{
+	if (lifeBoard->topology != topology) {
+		lifeBoard->topology = topology;
+		markBoardChanged(lifeBoard);
+	}
+}
 
-			if (LifeBoard->matrix[xMinusOne][y]) {
-				count++;
-			}
-			
-			if (LifeBoard->matrix[xPlusOne][y]) {
-				count++;
-			}
-			
-			if (LifeBoard->matrix[xMinusOne][yMinusOne]) {
-				count++;
-			}
-			
-			if (LifeBoard->matrix[x][yMinusOne]) {
-				count++;
-			}
+/*
+ * The step for one topology: the edges are all in the guards it fills in,
+ * so the tiles and the kernel run over them are the same for every one of
+ * them, and a topology costs nothing more than filling its guards.
+ */
+#define LIFE_TOPOLOGY_STEP(name, topology, fillGuards)			\
+void name(LifeBoard *lifeBoard)						\
+{									\
+	if (lifeBoard == NULL) {					\
+		return;							\
+	}								\
+									\
+	setTopology(lifeBoard, topology);				\
+	fillGuards(lifeBoard);						\
+	calculateBoard(lifeBoard);					\
+}
 
-			if (LifeBoard->matrix[xPlusOne][yMinusOne]) {
-				count++;
-			}
+/**
+ * Calcuate the next life cycle for all the cells
+ */
+LIFE_TOPOLOGY_STEP(calculateLife, LIFE_DEAD_EDGES, clearGuards)
 
-			/*
-			  The rules for the game of life are :
-			  
-			  Any live cell with fewer than two neighbors dies of loneliness.
-			  Any live cell with more than three neighbors dies of crowding.
-			  Any dead cell with exactly three neighbors comes to life.
-			  Any live cell with two or three neighbors lives, unchanged, to the
-			  next generation.
-			*/					
-			
-			if (LifeBoard->matrix[x][y]) {
-				
-				if (count < 2) {
-					newBoard[x][y] = false;
-				}
-				
-				else if (count > 3) {
-					newBoard[x][y] = false;
-				}
-				
-				else {
-					newBoard[x][y] = LifeBoard->matrix[x][y];
-				}
-				
-			}
-				
-			else {
-				
-				if (count == 3) {
-					newBoard[x][y] = true;
-				}
-				
-				else {
-					newBoard[x][y] = false;
-				}
-										
+/**
+ * Calcuate the next life cycle for all the cells with the board projected onto a torus.
+ */
+LIFE_TOPOLOGY_STEP(calculateLifeTorus, LIFE_TORUS, wrapGuards)
+
+/**
+ * Calcuate the next life cycle for all the cells with the board projected
+ * onto a Klein bottle.
+ */
+LIFE_TOPOLOGY_STEP(calculateLifeKlein, LIFE_KLEIN_BOTTLE, twistGuards)
+
+/**
+ * Calcuate the next life cycle for all the cells with the board mirrored at
+ * its edges.
+ */
+LIFE_TOPOLOGY_STEP(calculateLifeMirror, LIFE_MIRROR, mirrorGuards)
+
+static void (*const topologySteps[LIFE_TOPOLOGIES])(LifeBoard *) = {
+	calculateLife, calculateLifeTorus, calculateLifeKlein,
+	calculateLifeMirror
+};
+
+static const char *topologyNames[LIFE_TOPOLOGIES] = {
+	"dead", "torus", "klein", "mirror"
+};
+
+/**
+ * Calcuate the next life cycle for all the cells in the given topology.
+ */
+void calculateLifeTopology(LifeBoard *lifeBoard, LifeTopology topology)
+{
+	if ((unsigned int)topology < LIFE_TOPOLOGIES) {
+		topologySteps[topology](lifeBoard);
+	}
+}
+
+/**
+ * The name of the topology, as parsed by parseLifeTopology.
+ */
+const char *getLifeTopologyName(LifeTopology topology)
+{
+	return (unsigned int)topology < LIFE_TOPOLOGIES ?
+		topologyNames[topology] : NULL;
+}
+
+/**
+ * Parse a topology by name, dead, torus, klein or mirror.
+ */
+boolean parseLifeTopology(const char *name, LifeTopology *topology)
+{
+	for (int i = 0; i < LIFE_TOPOLOGIES; i++) {
+		if (strcmp(name, topologyNames[i]) == 0) {
+			*topology = (LifeTopology)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * What the threads calculating bands of the board several generations at
+ * a time all need to know.
+ */
+typedef struct LifeBlocks
+{
+	LifeBoard *lifeBoard;
+	int depth;
+	int bandRows;
+	int bands;
+	uint64_t *scratch;
+	size_t bufferWords;
+} LifeBlocks;
+
+/**
+ * Calculate rows y0 up to y1 of the board depth generations ahead into
+ * the back buffer. The rows are copied into a buffer of their own along
+ * with depth rows on either side, which is then calculated back and forth
+ * with another one, a row less on either side every generation, until
+ * only the band itself is left. The two buffers are sized to stay in the
+ * cache all the while, so the board is only read and written once.
+ */
+static void calculateBlock(LifeBlocks *blocks, int y0, int y1,
+			   uint64_t *buffers[2])
+{
+	LifeBoard *lifeBoard = blocks->lifeBoard;
+	int boardSize = lifeBoard->boardSize;
+	int words = lifeBoard->words;
+	long stride = lifeBoard->stride;
+	int depth = blocks->depth;
+	int rows = y1 - y0 + 2 * depth;
+	uint64_t tail = lowMask(boardSize % WORD_BITS);
+	unsigned char changes[lifeBoard->tilesX + 1];
+
+	for (int i = 0; i < rows; i++) {
+		int y = ((y0 - depth + i) % boardSize + boardSize) % boardSize;
+		(void)memcpy(buffers[0] + i * stride, lifeRow(lifeBoard, y),
+			     sizeof(uint64_t) * words);
+	}
+
+	for (int t = 0; t < depth; t++) {
+		uint64_t *in = buffers[t & 1];
+		uint64_t *out = buffers[(t + 1) & 1];
+
+		// rows t up to rows - t are right, and one more on either
+		// side of what can be calculated from them is needed.
+		for (int i = t; i < rows - t; i++) {
+			wrapRow(in + i * stride, boardSize);
+		}
+		for (int i = t + 1; i < rows - t - 1; i++) {
+			uint64_t *row = in + i * stride;
+			lifeRowKernel(row - stride, row, row + stride,
+				      out + i * stride, words, changes);
+			if (tail) {
+				out[i * stride + words - 1] &= tail;
 			}
 		}
 	}
 
-	destroyMatrix(LifeBoard->matrix, LifeBoard->boardSize);
-	LifeBoard->matrix = newBoard;
+	uint64_t *result = buffers[depth & 1];
+	for (int y = y0; y < y1; y++) {
+		(void)memcpy(lifeBoard->nextCells + y * stride,
+			     result + (y - y0 + depth) * stride,
+			     sizeof(uint64_t) * words);
+	}
+}
+
+/**
+ * Worker task calculating every count-th band of the board, starting with
+ * band index, in buffers of its own.
+ */
+static void calculateBlocks(void *arg, int index, int count)
+{
+	LifeBlocks *blocks = (LifeBlocks *)arg;
+	int boardSize = blocks->lifeBoard->boardSize;
+	uint64_t *first = blocks->scratch + 2 * (size_t)index *
+		blocks->bufferWords + LIFE_ROW_OFFSET;
+	uint64_t *buffers[2] = { first, first + blocks->bufferWords };
+
+	for (int band = index; band < blocks->bands; band += count) {
+		int y0 = band * blocks->bandRows;
+		int y1 = y0 + blocks->bandRows;
+
+		calculateBlock(blocks, y0, y1 < boardSize ? y1 : boardSize,
+			       buffers);
+	}
+}
+
+/**
+ * Calculate depth generations ahead with the board projected onto a torus,
+ * taking a band of rows at a time through all of them while it is in the
+ * cache. The cells come out the same as from depth single steps, but the
+ * board only goes through memory once rather than depth times, in return
+ * for calculating the depth rows around each band over again. This pays
+ * for boards too big for the cache; the tiles are not kept track of, so
+ * still regions cost as much as any other.
+ *
+ * With hashes or counts turned on the generations are taken one at a
+ * time, since they are kept per generation.
+ */
+void calculateLifeTorusBlocked(LifeBoard *lifeBoard, int depth)
+{
+	if (lifeBoard == NULL || depth <= 0) {
+		return;
+	}
+
+	if (depth == 1 || lifeBoard->tileHashes != NULL ||
+	    lifeBoard->tileCounts != NULL) {
+		for (int i = 0; i < depth; i++) {
+			calculateLifeTorus(lifeBoard);
+		}
+		return;
+	}
+
+	// as many rows a band as fit the cache with the rows around them.
+	int boardSize = lifeBoard->boardSize;
+	long rowBytes = sizeof(uint64_t) * lifeBoard->stride;
+	long bandRows = LIFE_BLOCK_BYTES / (2 * rowBytes) - 2L * depth;
+	if (bandRows < LIFE_TILE_ROWS) {
+		bandRows = LIFE_TILE_ROWS;
+	}
+	if (bandRows > boardSize) {
+		bandRows = boardSize;
+	}
+
+	LifeBlocks blocks;
+	blocks.lifeBoard = lifeBoard;
+	blocks.depth = depth;
+	blocks.bandRows = (int)bandRows;
+	blocks.bands = (int)((boardSize + bandRows - 1) / bandRows);
+	blocks.bufferWords = (size_t)lifeBoard->stride *
+		(size_t)(bandRows + 2L * depth) + LIFE_ROW_OFFSET;
+
+	// two buffers for every thread, kept for the next time.
+	int threads = lifeBoard->workers ? lifeBoard->workers->threads : 1;
+	size_t bytes = sizeof(uint64_t) * 2 * blocks.bufferWords * threads;
+	if (lifeBoard->scratch == NULL ||
+	    lifeBoard->scratch->capacity < bytes) {
+		destroyArena(lifeBoard->scratch);
+		lifeBoard->scratch = createArena(bytes);
+	}
+	if (lifeBoard->scratch == NULL) {
+		for (int i = 0; i < depth; i++) {
+			calculateLifeTorus(lifeBoard);
+		}
+		return;
+	}
+	resetArena(lifeBoard->scratch);
+	blocks.scratch = (uint64_t *)allocateArena(lifeBoard->scratch, bytes,
+						   LIFE_CACHE_LINE);
+
+	setTopology(lifeBoard, LIFE_TORUS);
+	runWorkerPool(lifeBoard->workers, &calculateBlocks, &blocks);
+	swapLifeBoard(lifeBoard);
 }
-	
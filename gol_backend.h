@@ -23,22 +23,172 @@
 #ifndef __BOL_BACKEND_H_
 #define __BOL_BACKEND_H_
 
+#include <stdint.h>
+#include <stdio.h>
+
 typedef enum boolean { true = 1, false = 0 } boolean;
 
+/*
+ * What lies beyond the edges of the board: dead cells, the opposite edge,
+ * the opposite edge left and right but flipped over at the top and bottom,
+ * or the edge itself, as if in a mirror.
+ */
+typedef enum LifeTopology
+{
+	LIFE_DEAD_EDGES = 0,
+	LIFE_TORUS,
+	LIFE_KLEIN_BOTTLE,
+	LIFE_MIRROR,
+	LIFE_TOPOLOGIES
+} LifeTopology;
+
+/*
+ * What happened in a generation: the live cells, those born and those that
+ * died since the one before, and the smallest box around the live cells,
+ * with minX past maxX if there are none.
+ */
+typedef struct LifeStatistics
+{
+	unsigned long long population;
+	unsigned long long births;
+	unsigned long long deaths;
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+} LifeStatistics;
+
+/* The live cells of a tile, and the births and deaths that led to them. */
+typedef struct LifeTileCounts
+{
+	unsigned long long population;
+	unsigned long long births;
+	unsigned long long deaths;
+} LifeTileCounts;
+
+/*
+ * The cells are packed 64 to a word, cell (x, y) being bit (x & 63) of word
+ * (x >> 6) in row y. Each row is kept in one contiguous, cache line aligned
+ * allocation together with a guard word on either side, and the board has a
+ * guard row above and below. Before each generation the guards are filled in
+ * with the neighbours from the other side of the board, so the kernels never
+ * have to look out for the edges.
+ *
+ * The next generation is written to a second buffer of the same shape,
+ * and the two are swapped once it is complete. If the board has been given
+ * a pool of workers, each of them calculates its own band of rows. Both
+ * buffers and everything kept per tile come out of one arena, so a board
+ * is a single mapping, of huge pages if they were asked for.
+ *
+ * The board is also divided into tiles of LIFE_TILE_ROWS rows by
+ * LIFE_TILE_WORDS words, with a flag per tile telling whether its cells
+ * differ from what they were two generations ago, which is what the back
+ * buffer holds when it is overwritten. A tile is only calculated if it or
+ * one of its eight neighbours changed; otherwise the back buffer already
+ * holds the right cells, so still lifes and blinkers cost nothing. Cells
+ * written from outside have their tiles flagged for two generations, since
+ * only the front buffer has them.
+ *
+ * Once hashing has been turned on, each buffer also keeps a hash of every
+ * tile and where it is. Only the tiles flagged as changed are hashed
+ * again, and the hash of the whole board is the XOR of those of its tiles.
+ * The same goes for the live cells of each tile once they are counted,
+ * which the kernel does as it writes the new words. A tile that is
+ * skipped holds what it held two generations ago, and so went through the
+ * same births and deaths on the way there.
+ */
 typedef struct LifeBoard
 {
-	boolean **matrix;
+	uint64_t *cells;
+	uint64_t *nextCells;
+	struct LifeArena *arena;
+	struct LifeArena *scratch;
 	int boardSize;
+	int words;
+	int stride;
+	struct WorkerPool *workers;
+	LifeTopology topology;
+	int tilesX;
+	int tilesY;
+	unsigned char *changed;
+	unsigned char *nextChanged;
+	uint64_t *tileHashes;
+	uint64_t *nextTileHashes;
+	LifeTileCounts *tileCounts;
+	LifeTileCounts *nextTileCounts;
 } LifeBoard;
 
+/* Number of words in front of the first cell of each row. */
+#define LIFE_ROW_OFFSET 8
+
+/*
+ * Size of the tiles that are skipped when nothing around them changes. The
+ * width has to be a whole number of the widest vectors the kernels use.
+ */
+#define LIFE_TILE_WORDS 8
+#define LIFE_TILE_ROWS  16
+
+/*
+ * Bytes of cache a band of rows is sized to fit in when several
+ * generations are calculated at a time, with both of its buffers.
+ */
+#define LIFE_BLOCK_BYTES (1024 * 1024)
+
+/* Bits of precision the density of a random board is rounded to. */
+#define LIFE_DENSITY_BITS 8
+
+/**
+ * Get a pointer to the first word of row y, -1 and boardSize being the
+ * guard rows.
+ */
+static inline uint64_t *lifeRow(const LifeBoard *lifeBoard, int y)
+{
+	return lifeBoard->cells + (long)y * lifeBoard->stride;
+}
+
+/**
+ * Mix the bits of a word, the finaliser of splitmix64.
+ */
+static inline uint64_t mixWord(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+/**
+ * Random word number counter of the stream for seed: splitmix64 taken as a
+ * counter based generator, so any word can be had without the ones before
+ * it.
+ */
+static inline uint64_t randomWord(uint64_t seed, uint64_t counter)
+{
+	return mixWord(seed + (counter + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
 LifeBoard *createLifeBoard(int);
 void destroyLifeBoard(LifeBoard *);
-void randomizeBoard(LifeBoard *);
+void randomizeRow(uint64_t *, int, uint64_t, uint64_t, double);
+void randomizeBoard(LifeBoard *, uint64_t, double);
 
 boolean getCell(LifeBoard *, int, int);
 boolean setCell(LifeBoard *, int, int, boolean);
+void markBoardChanged(LifeBoard *);
+boolean enableBoardHash(LifeBoard *);
+uint64_t getBoardHash(LifeBoard *);
+boolean enableBoardStatistics(LifeBoard *);
+void getBoardStatistics(LifeBoard *, LifeStatistics *);
+void writeBoardStatistics(FILE *, LifeBoard *, unsigned long long);
 
 void calculateLife(LifeBoard *);
 void calculateLifeTorus(LifeBoard *);
+void calculateLifeKlein(LifeBoard *);
+void calculateLifeMirror(LifeBoard *);
+void calculateLifeTopology(LifeBoard *, LifeTopology);
+const char *getLifeTopologyName(LifeTopology);
+boolean parseLifeTopology(const char *, LifeTopology *);
+void swapLifeBoard(LifeBoard *);
+void calculateLifeTorusBlocked(LifeBoard *, int);
 
 #endif
@@ -0,0 +1,314 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_domain.h"
+#include "gol_kernel.h"
+
+#define WORD_BITS 64
+
+/* Steps to the neighbour in each direction. */
+static const int stepX[LIFE_DIRECTIONS] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int stepY[LIFE_DIRECTIONS] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+/**
+ * Tell whether the messages in direction d are a whole edge rather than
+ * the cell in a corner.
+ */
+static inline boolean isEdge(int d)
+{
+	return d % 2 == 0;
+}
+
+/**
+ * Find the ranks next to rank in every direction, on a grid of ranksX by
+ * ranksY that wraps around. On a narrow grid the same rank can be there
+ * more than once, and rank itself too.
+ */
+void findDomainNeighbours(int rank, int ranksX, int ranksY, int *neighbours)
+{
+	int x = rank % ranksX;
+	int y = rank / ranksX;
+
+	for (int d = 0; d < LIFE_DIRECTIONS; d++) {
+		int nx = (x + stepX[d] + ranksX) % ranksX;
+		int ny = (y + stepY[d] + ranksY) % ranksY;
+		neighbours[d] = ny * ranksX + nx;
+	}
+}
+
+/**
+ * Create the subdomain of the rank of transport, boardSize cells square,
+ * on a grid of ranksX by ranksY. The side has to be a whole number of
+ * words, so the halo columns fall on the guard words.
+ *
+ * @Return the subdomain, or NULL if out of memory or the grid does not fit
+ * the transport
+ */
+LifeDomain *createDomain(int boardSize, int ranksX, int ranksY,
+			 LifeTransport *transport)
+{
+	if (transport == NULL || boardSize <= 0 || boardSize % WORD_BITS != 0 ||
+	    ranksX <= 0 || ranksY <= 0 ||
+	    transport->ranks != ranksX * ranksY) {
+		return NULL;
+	}
+
+	LifeDomain *domain = (LifeDomain *)calloc(1, sizeof(LifeDomain));
+	if (domain == NULL) {
+		return NULL;
+	}
+
+	domain->board = createLifeBoard(boardSize);
+	if (domain->board == NULL) {
+		free(domain);
+		return NULL;
+	}
+
+	int words = domain->board->words;
+	domain->messages = (uint64_t *)calloc(2 * LIFE_DIRECTIONS * (size_t)words,
+					      sizeof(uint64_t));
+	domain->changes = (unsigned char *)malloc(
+		(size_t)domain->board->tilesX + 1);
+	if (domain->messages == NULL || domain->changes == NULL) {
+		destroyDomain(domain);
+		return NULL;
+	}
+
+	domain->transport = transport;
+	domain->ranksX = ranksX;
+	domain->ranksY = ranksY;
+	domain->x = transport->rank % ranksX;
+	domain->y = transport->rank / ranksX;
+	findDomainNeighbours(transport->rank, ranksX, ranksY,
+			     domain->neighbours);
+
+	for (int d = 0; d < LIFE_DIRECTIONS; d++) {
+		domain->outgoing[d] = domain->messages + (size_t)d * words;
+		domain->incoming[d] = domain->messages +
+			(size_t)(LIFE_DIRECTIONS + d) * words;
+	}
+
+	return domain;
+}
+
+/**
+ * Free a subdomain. The transport is left to the caller.
+ */
+void destroyDomain(LifeDomain *domain)
+{
+	if (domain == NULL) {
+		return;
+	}
+
+	destroyLifeBoard(domain->board);
+	free(domain->messages);
+	free(domain->changes);
+	free(domain);
+}
+
+/**
+ * Fill the subdomain with random cells, live with the chance density, each
+ * word worked out from seed and where it is on the whole board, so the
+ * board comes out the same however it is split up, and the same as a
+ * board of that size randomized in one piece.
+ */
+void seedDomain(LifeDomain *domain, uint64_t seed, double density)
+{
+	LifeBoard *board = domain->board;
+	int words = board->words;
+	uint64_t totalWords = (uint64_t)words * domain->ranksX;
+
+	for (int y = 0; y < board->boardSize; y++) {
+		uint64_t globalY = (uint64_t)domain->y * board->boardSize + y;
+
+		randomizeRow(lifeRow(board, y), words, seed,
+			     globalY * totalWords + (uint64_t)domain->x * words,
+			     density);
+	}
+
+	markBoardChanged(board);
+}
+
+/**
+ * Get the cells of column x, bit y % 64 of word y / 64.
+ */
+static void packColumn(LifeBoard *board, int x, uint64_t *column)
+{
+	for (int w = 0; w < board->words; w++) {
+		uint64_t bits = 0;
+		for (int b = 0; b < WORD_BITS; b++) {
+			const uint64_t *row = lifeRow(board, w * WORD_BITS + b);
+			bits |= ((row[x / WORD_BITS] >> (x % WORD_BITS)) & 1) << b;
+		}
+		column[w] = bits;
+	}
+}
+
+/**
+ * Put what goes to the neighbour in direction d into its message.
+ */
+static void packEdge(LifeDomain *domain, int d)
+{
+	LifeBoard *board = domain->board;
+	int max = board->boardSize - 1;
+	uint64_t *message = domain->outgoing[d];
+	int x = stepX[d] < 0 ? 0 : max;
+	int y = stepY[d] < 0 ? 0 : max;
+
+	if (stepX[d] == 0) {
+		(void)memcpy(message, lifeRow(board, y),
+			     sizeof(uint64_t) * board->words);
+	} else if (stepY[d] == 0) {
+		packColumn(board, x, message);
+	} else {
+		message[0] = (lifeRow(board, y)[x / WORD_BITS] >>
+			      (x % WORD_BITS)) & 1;
+	}
+}
+
+/**
+ * Put what came from the neighbour in direction d into the halo.
+ */
+static void unpackEdge(LifeDomain *domain, int d)
+{
+	LifeBoard *board = domain->board;
+	int boardSize = board->boardSize;
+	int words = board->words;
+	const uint64_t *message = domain->incoming[d];
+	int y = stepY[d] < 0 ? -1 : boardSize;
+
+	if (stepX[d] == 0) {
+		(void)memcpy(lifeRow(board, y), message,
+			     sizeof(uint64_t) * words);
+	} else if (stepY[d] == 0) {
+		for (int row = 0; row < boardSize; row++) {
+			uint64_t bit = (message[row / WORD_BITS] >>
+					(row % WORD_BITS)) & 1;
+			uint64_t *cells = lifeRow(board, row);
+			if (stepX[d] < 0) {
+				cells[-1] = bit << (WORD_BITS - 1);
+			} else {
+				cells[words] = bit;
+			}
+		}
+	} else if (stepX[d] < 0) {
+		lifeRow(board, y)[-1] = message[0] << (WORD_BITS - 1);
+	} else {
+		lifeRow(board, y)[words] = message[0];
+	}
+}
+
+/**
+ * Calculate words w0 up to w1 of row y into the back buffer.
+ */
+static void calculateWords(LifeDomain *domain, int y, int w0, int w1)
+{
+	LifeBoard *board = domain->board;
+	long stride = board->stride;
+	const uint64_t *row = lifeRow(board, y);
+
+	if (w1 > w0) {
+		lifeRowKernel(row - stride + w0, row + w0, row + stride + w0,
+			      board->nextCells + y * stride + w0, w1 - w0,
+			      domain->changes);
+	}
+}
+
+/**
+ * Calculate the next generation of the subdomain, swapping halos with the
+ * neighbours.
+ *
+ * @Return false if the neighbours could not be reached
+ */
+boolean stepDomain(LifeDomain *domain)
+{
+	LifeBoard *board = domain->board;
+	LifeTransport *transport = domain->transport;
+	int boardSize = board->boardSize;
+	int words = board->words;
+	boolean success = true;
+
+	// post the receives first, so no message has to wait for one
+	for (int d = 0; d < LIFE_DIRECTIONS && success; d++) {
+		size_t length = sizeof(uint64_t) * (isEdge(d) ? words : 1);
+		success = receiveMessage(transport, domain->neighbours[d],
+					 (d + LIFE_DIRECTIONS / 2) %
+					 LIFE_DIRECTIONS,
+					 domain->incoming[d], length);
+	}
+
+	for (int d = 0; d < LIFE_DIRECTIONS && success; d++) {
+		size_t length = sizeof(uint64_t) * (isEdge(d) ? words : 1);
+		packEdge(domain, d);
+		success = sendMessage(transport, domain->neighbours[d], d,
+				      domain->outgoing[d], length);
+	}
+
+	// the interior, while the halo is on its way
+	for (int y = 1; y < boardSize - 1; y++) {
+		calculateWords(domain, y, 1, words - 1);
+	}
+
+	if (!success || !waitMessages(transport)) {
+		return false;
+	}
+
+	for (int d = 0; d < LIFE_DIRECTIONS; d++) {
+		unpackEdge(domain, d);
+	}
+
+	// and the rim around it
+	calculateWords(domain, 0, 0, words);
+	calculateWords(domain, boardSize - 1, 0, words);
+	for (int y = 1; y < boardSize - 1; y++) {
+		calculateWords(domain, y, 0, 1);
+		if (words > 1) {
+			calculateWords(domain, y, words - 1, words);
+		}
+	}
+
+	swapLifeBoard(board);
+
+	return true;
+}
+
+/**
+ * Count the live cells of the subdomain.
+ */
+unsigned long long countDomain(LifeDomain *domain)
+{
+	LifeBoard *board = domain->board;
+	unsigned long long population = 0;
+
+	for (int y = 0; y < board->boardSize; y++) {
+		const uint64_t *row = lifeRow(board, y);
+		for (int w = 0; w < board->words; w++) {
+			population += (unsigned long long)
+				__builtin_popcountll(row[w]);
+		}
+	}
+
+	return population;
+}
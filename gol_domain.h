@@ -0,0 +1,80 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_DOMAIN_H_
+#define __GOL_DOMAIN_H_
+
+#include <stdint.h>
+
+#include "gol_backend.h"
+#include "gol_transport.h"
+
+/* The neighbours of a subdomain, clockwise from the one above it. */
+typedef enum LifeDirection
+{
+	LIFE_NORTH = 0,
+	LIFE_NORTH_EAST,
+	LIFE_EAST,
+	LIFE_SOUTH_EAST,
+	LIFE_SOUTH,
+	LIFE_SOUTH_WEST,
+	LIFE_WEST,
+	LIFE_NORTH_WEST,
+	LIFE_DIRECTIONS
+} LifeDirection;
+
+/*
+ * One rank's part of a board that is split into a grid of ranksX by
+ * ranksY square subdomains over as many processes, the grid wrapping
+ * around like a torus. Rank r has the subdomain in column r % ranksX and
+ * row r / ranksX.
+ *
+ * Every generation each rank sends the cells along its edges and corners
+ * to the neighbours on that side, and gets theirs back into its guards,
+ * the halo of cells around its own. The cells of the interior do not
+ * depend on the halo and are calculated while the messages are on their
+ * way; only the outermost rows and words are left for when they are in.
+ * A message goes with the direction it travels in as its tag.
+ */
+typedef struct LifeDomain
+{
+	LifeBoard *board;
+	LifeTransport *transport;
+	int ranksX;
+	int ranksY;
+	int x;
+	int y;
+	int neighbours[LIFE_DIRECTIONS];
+	uint64_t *outgoing[LIFE_DIRECTIONS];
+	uint64_t *incoming[LIFE_DIRECTIONS];
+	uint64_t *messages;
+	unsigned char *changes;
+} LifeDomain;
+
+void findDomainNeighbours(int, int, int, int *);
+LifeDomain *createDomain(int, int, int, LifeTransport *);
+void destroyDomain(LifeDomain *);
+void seedDomain(LifeDomain *, uint64_t, double);
+boolean stepDomain(LifeDomain *);
+unsigned long long countDomain(LifeDomain *);
+
+#endif
@@ -22,76 +22,225 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <GL/glfw.h>
 
 #include "gol_frontend.h"
-
-#define ARC4RANDOM_MAX      0x100000000
+#include "gol_simulation.h"
 
 extern int running;
-extern int step;
-extern int simulation;
 extern float sleepTime;
 extern float sleepFactor;
 extern LifeBoard *board;
+extern LifeSimulation *lifeSimulation;
 extern float scaleFactor;
+extern int verbosity;
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#define GL_STREAM_DRAW         0x88E0
+#define GL_WRITE_ONLY          0x88B9
+#endif
+
+// the colour live cells are drawn in, dead ones are black.
+static const Colour liveColour = {0.2f, 0.9f, 0.3f};
+
+/*
+ * The board is drawn as a single texture with one byte per cell, uploaded
+ * once per frame. With pixel buffer objects the cells are written straight
+ * into memory the driver can copy from without waiting; without them they
+ * go through a buffer of our own.
+ */
+typedef struct BoardTexture
+{
+	GLuint texture;
+	GLuint pixelBuffer;
+	int boardSize;
+	int textureSize;
+	int pitch;
+	unsigned char *pixels;
+} BoardTexture;
+
+static BoardTexture boardTexture = { 0, 0, 0, 0, 0, NULL };
+
+/* The pixel buffer functions, looked up at run time. */
+static void (*genBuffers)(GLsizei, GLuint *) = NULL;
+static void (*deleteBuffers)(GLsizei, const GLuint *) = NULL;
+static void (*bindBuffer)(GLenum, GLuint) = NULL;
+static void (*bufferData)(GLenum, ptrdiff_t, const void *, GLenum) = NULL;
+static void *(*mapBuffer)(GLenum, GLenum) = NULL;
+static GLboolean (*unmapBuffer)(GLenum) = NULL;
+
+/* The eight pixels for every byte of cells. */
+static unsigned char cellPixels[256][8];
 
 /**
+ * Look up the pixel buffer functions, if the driver has them.
  *
- *
+ * @Return true if pixel buffer objects can be used
  */
-static void renderSquare(int x, int y, float s, Colour c)
+static boolean loadPixelBuffers(void)
 {
-	float z = 0.0f;
-	float fX = (float)x * (s*1.0f);
-	float fY = (float)y * (s*1.0f);
-
-#ifdef _DEBUG_
-	printf("[(%f, %f),",   fX,   fY);
-	printf( "(%f, %f),",   fX+s, fY);
-	printf( "(%f, %f),",   fX+s, fY-s);
-	printf( "(%f, %f)]\n", fX,   fY-s);
-	(void)fflush(NULL);
-#endif
-	glBegin(GL_QUADS);
-	glColor3f(c.red, c.green, c.blue);
-	glVertex3f(fX,   fY,   z); 
-	glVertex3f(fX+s, fY,   z);   
-	glVertex3f(fX+s, fY-s, z); 
-	glVertex3f(fX,   fY-s, z); 
-	glEnd();
+	if (!glfwExtensionSupported("GL_ARB_pixel_buffer_object")) {
+		return false;
+	}
 
-	return;
+	genBuffers = (void (*)(GLsizei, GLuint *))
+		glfwGetProcAddress("glGenBuffersARB");
+	deleteBuffers = (void (*)(GLsizei, const GLuint *))
+		glfwGetProcAddress("glDeleteBuffersARB");
+	bindBuffer = (void (*)(GLenum, GLuint))
+		glfwGetProcAddress("glBindBufferARB");
+	bufferData = (void (*)(GLenum, ptrdiff_t, const void *, GLenum))
+		glfwGetProcAddress("glBufferDataARB");
+	mapBuffer = (void *(*)(GLenum, GLenum))
+		glfwGetProcAddress("glMapBufferARB");
+	unmapBuffer = (GLboolean (*)(GLenum))
+		glfwGetProcAddress("glUnmapBufferARB");
+
+	return genBuffers && deleteBuffers && bindBuffer && bufferData &&
+		mapBuffer && unmapBuffer;
 }
 
 /**
- *
+ * Set up the texture for a board of the given size, the smallest power of
+ * two that fits it, to work with older drivers too.
+ */
+static void createBoardTexture(BoardTexture *t, int boardSize)
+{
+	for (int i = 0; i < 256; i++) {
+		for (int bit = 0; bit < 8; bit++) {
+			cellPixels[i][bit] = (i >> bit) & 1 ? 0xff : 0x00;
+		}
+	}
+
+	t->boardSize = boardSize;
+	t->textureSize = 1;
+	while (t->textureSize < boardSize) {
+		t->textureSize *= 2;
+	}
+	// whole words of cells, so rows can be written 64 pixels at a time.
+	t->pitch = (boardSize + 63) / 64 * 64;
+
+	(void)glGenTextures(1, &t->texture);
+	(void)glBindTexture(GL_TEXTURE_2D, t->texture);
+	(void)glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	(void)glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	(void)glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, t->textureSize,
+			   t->textureSize, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE,
+			   NULL);
+
+	size_t size = (size_t)t->pitch * boardSize;
+	if (loadPixelBuffers()) {
+		genBuffers(1, &t->pixelBuffer);
+		bindBuffer(GL_PIXEL_UNPACK_BUFFER, t->pixelBuffer);
+		bufferData(GL_PIXEL_UNPACK_BUFFER, (ptrdiff_t)size, NULL,
+			   GL_STREAM_DRAW);
+		bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	} else {
+		t->pixels = (unsigned char *)malloc(size);
+		assert(t->pixels != NULL);
+	}
+}
+
+/**
+ * Free the texture and its pixel buffer.
+ */
+void destroyBoardTexture(void)
+{
+	BoardTexture *t = &boardTexture;
+
+	if (t->pixelBuffer) {
+		deleteBuffers(1, &t->pixelBuffer);
+	}
+	if (t->texture) {
+		(void)glDeleteTextures(1, &t->texture);
+	}
+	free(t->pixels);
+	(void)memset(t, 0x0, sizeof(*t));
+}
+
+/**
+ * Write one byte per cell, eight cells at a time.
  */
-void renderBoard(LifeBoard *board, float scale)
+static void fillPixels(LifeBoard *board, unsigned char *pixels, int pitch)
 {
-	Colour c = {0.0f, 0.0f, 0.0f};
+	for (int y = 0; y < board->boardSize; y++) {
+		const uint64_t *row = lifeRow(board, y);
+		unsigned char *out = pixels + (size_t)y * pitch;
+
+		for (int w = 0; w < board->words; w++) {
+			uint64_t word = row[w];
+			for (int i = 0; i < 8; i++) {
+				(void)memcpy(out, cellPixels[(word >> (i * 8)) &
+							     0xff], 8);
+				out += 8;
+			}
+		}
+	}
+}
+
+/**
+ * Draw the board as one textured quad covering the window, with the first
+ * row at the top.
+ */
+void renderBoard(LifeBoard *board)
+{
+	BoardTexture *t = &boardTexture;
 
 	// quick sanity check.
 	assert(board != NULL);
-	assert(scale > 0.0f);
-
-	for(int x=0; x<board->boardSize; x++) {
-		for(int y=0; y<board->boardSize; y++) {
-			if(getCell(board, x, y) == true) {
-#ifdef __APPLE__
-				c.red =   (float)arc4random()/ARC4RANDOM_MAX;
-				c.green = (float)arc4random()/ARC4RANDOM_MAX;
-				c.blue =  (float)arc4random()/ARC4RANDOM_MAX;
-#else
-				c.red =   (float)random()/ARC4RANDOM_MAX;
-				c.green = (float)random()/ARC4RANDOM_MAX;
-				c.blue =  (float)random()/ARC4RANDOM_MAX;
-#endif
-				renderSquare(x, y, scale, c);
-			}
+
+	if (t->boardSize != board->boardSize) {
+		destroyBoardTexture();
+		createBoardTexture(t, board->boardSize);
+	}
+
+	(void)glBindTexture(GL_TEXTURE_2D, t->texture);
+	(void)glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	(void)glPixelStorei(GL_UNPACK_ROW_LENGTH, t->pitch);
+
+	if (t->pixelBuffer) {
+		size_t size = (size_t)t->pitch * t->boardSize;
+		bindBuffer(GL_PIXEL_UNPACK_BUFFER, t->pixelBuffer);
+		// let go of last frame's copy instead of waiting for it.
+		bufferData(GL_PIXEL_UNPACK_BUFFER, (ptrdiff_t)size, NULL,
+			   GL_STREAM_DRAW);
+		unsigned char *pixels = (unsigned char *)
+			mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+		if (pixels != NULL) {
+			fillPixels(board, pixels, t->pitch);
+			(void)unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			(void)glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+					      t->boardSize, t->boardSize,
+					      GL_LUMINANCE, GL_UNSIGNED_BYTE,
+					      NULL);
 		}
+		bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	} else {
+		fillPixels(board, t->pixels, t->pitch);
+		(void)glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, t->boardSize,
+				      t->boardSize, GL_LUMINANCE,
+				      GL_UNSIGNED_BYTE, t->pixels);
 	}
+	(void)glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	float edge = (float)t->boardSize / (float)t->textureSize;
+	(void)glEnable(GL_TEXTURE_2D);
+	glColor3f(liveColour.red, liveColour.green, liveColour.blue);
+	glBegin(GL_QUADS);
+	glTexCoord2f(0.0f, 0.0f);
+	glVertex2f(-1.0f, 1.0f);
+	glTexCoord2f(edge, 0.0f);
+	glVertex2f(1.0f, 1.0f);
+	glTexCoord2f(edge, edge);
+	glVertex2f(1.0f, -1.0f);
+	glTexCoord2f(0.0f, edge);
+	glVertex2f(-1.0f, -1.0f);
+	glEnd();
+	(void)glDisable(GL_TEXTURE_2D);
 
 	return;
 }
@@ -107,46 +256,64 @@ void processKeyPress(int key, int action)
 		return;
 	}
 
-#ifdef _DEBUG_
-	printf("key %d, with action %d\n", key, action);
-	(void)fflush(NULL);
-#endif
+	if (verbosity > 1) {
+		printf("key %d, with action %d\n", key, action);
+		(void)fflush(NULL);
+	}
+
+	LifeCommand command = { LIFE_PAUSE, 0, 0, 0.0f };
 
 	switch(key) {
 	case GLFW_KEY_ESC:
 	case 'Q':
 	case 'q':
 		running = GL_FALSE;
-		break;
+		return;
 	case 'S':
 	case 's':
 		// start/stop the simulation.
-		simulation = simulation == GL_TRUE ? GL_FALSE : GL_TRUE;
-		step = GL_FALSE;
+		command.type = LIFE_PAUSE;
 		break;
 	case GLFW_KEY_RIGHT:
 	case 'N':
 	case 'n':
 		// step one generation forwards.
-		simulation = GL_TRUE;
-		step = GL_TRUE;
+		command.type = LIFE_STEP;
 		break;
 	case 'P':
 	case 'p':
 		// step one generation backwards.
+		command.type = LIFE_BACK;
+		break;
+	case 'J':
+	case 'j':
+		// jump ahead as many generations as given with -j.
+		command.type = LIFE_JUMP;
 		break;
+	case 'T':
+	case 't':
+		// print how long the phases of a frame have taken so far.
+		printProfile(stdout, lifeSimulation->profile);
+		return;
 	case GLFW_KEY_UP:
 		// increase the simulation speed
-		sleepTime -= sleepFactor;
+		sleepTime = sleepTime > sleepFactor ? sleepTime - sleepFactor :
+			0.0f;
+		command.type = LIFE_DELAY;
+		command.delay = sleepTime;
 		break;
 	case GLFW_KEY_DOWN:
 		// decrease the simulation speed
 		sleepTime += sleepFactor;
+		command.type = LIFE_DELAY;
+		command.delay = sleepTime;
 		break;
 	default:
-		break;
+		return;
 	}
 
+	(void)sendCommand(lifeSimulation, &command);
+
 	return;
 }
 
@@ -169,17 +336,15 @@ void processMouseClick(int button, int action)
 	x = x / (int)scaleFactor;
 	y = y / (int)scaleFactor;
 
-	boolean currentState = getCell(board, x, y);
-	boolean newState = currentState ? false : true;
-	(void)setCell(board, x, y, newState);
-
-//#ifdef _DEBUG_
-	printf("Button %d, with action %d on ", button, action);
-	printf("(%d, %d)\n", x, y);
-	printf("currentState: %d, setting newState: %d\n", currentState,
-	       newState);
-	(void)fflush(NULL);
-//#endif
+	// the simulation owns the board, so it does the flipping.
+	LifeCommand command = { LIFE_TOGGLE_CELL, x, y, 0.0f };
+	(void)sendCommand(lifeSimulation, &command);
+
+	if (verbosity > 1) {
+		printf("Button %d, with action %d on ", button, action);
+		printf("(%d, %d)\n", x, y);
+		(void)fflush(NULL);
+	}
 
 	return;
 }
@@ -33,6 +33,7 @@ typedef struct Colour {
 
 void processKeyPress(int, int);
 void processMouseClick(int, int);
-void renderBoard(LifeBoard *, float);
+void renderBoard(LifeBoard *);
+void destroyBoardTexture(void);
 
 #endif
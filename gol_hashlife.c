@@ -0,0 +1,823 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_hashlife.h"
+#include "gol_kernel.h"
+
+#define NODES_PER_BLOCK 4096
+#define ROW_MUX(s, a, b) ((a) ^ (((a) ^ (b)) & (s)))
+#define MIN_BUCKETS     (1 << 16)
+
+/**
+ * Hash the four quadrants of a node, or the cells of a leaf.
+ */
+static size_t hashNode(LifeNode *nw, LifeNode *ne, LifeNode *sw, LifeNode *se,
+		       uint64_t cells)
+{
+	uint64_t h = (cells ^ (uint64_t)(uintptr_t)nw) * 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (uint64_t)(uintptr_t)ne) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (uint64_t)(uintptr_t)sw) * 0x94d049bb133111ebULL;
+	h = (h ^ (uint64_t)(uintptr_t)se) * 0x9e3779b97f4a7c15ULL;
+
+	// the buckets are picked by the low bits, so fold the high ones in.
+	h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+
+	return (size_t)(h ^ (h >> 33));
+}
+
+/**
+ * Take a node off the free list, growing the pool by another block when
+ * it is empty.
+ *
+ * @Return the node, or NULL if the step has made as many as it may or
+ * out of memory
+ */
+static LifeNode *allocateNode(LifeUniverse *universe)
+{
+	if (universe->nodes >= universe->limit) {
+		universe->exhausted = true;
+		return NULL;
+	}
+
+	if (universe->free == NULL) {
+		LifeNode *block =
+			(LifeNode *)malloc(sizeof(LifeNode) * NODES_PER_BLOCK);
+		void **blocks = (void **)realloc(universe->blocks,
+			sizeof(void *) * (universe->blockCount + 1));
+		if (blocks != NULL) {
+			universe->blocks = blocks;
+		}
+		if (block == NULL || blocks == NULL) {
+			free(block);
+			universe->exhausted = true;
+			return NULL;
+		}
+
+		universe->blocks[universe->blockCount++] = block;
+		for (int i = 0; i < NODES_PER_BLOCK; i++) {
+			block[i].next = universe->free;
+			universe->free = &block[i];
+		}
+	}
+
+	LifeNode *node = universe->free;
+	universe->free = node->next;
+
+	return node;
+}
+
+/**
+ * Double the number of hash buckets once there are more nodes than
+ * buckets.
+ */
+static void growBuckets(LifeUniverse *universe)
+{
+	size_t count = universe->bucketCount * 2;
+	LifeNode **buckets = (LifeNode **)calloc(count, sizeof(LifeNode *));
+
+	if (buckets == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < universe->bucketCount; i++) {
+		LifeNode *node = universe->buckets[i];
+		while (node != NULL) {
+			LifeNode *next = node->next;
+			size_t h = hashNode(node->quadrant[NW], node->quadrant[NE],
+					    node->quadrant[SW], node->quadrant[SE],
+					    node->cells) & (count - 1);
+			node->next = buckets[h];
+			buckets[h] = node;
+			node = next;
+		}
+	}
+
+	free(universe->buckets);
+	universe->buckets = buckets;
+	universe->bucketCount = count;
+}
+
+/**
+ * Get the canonical node with the given quadrants, or the leaf with the
+ * given cells when the quadrants are NULL, making it if there is none
+ * yet.
+ *
+ * @Return the node, or NULL if it could not be made
+ */
+static LifeNode *findNode(LifeUniverse *universe, LifeNode *nw, LifeNode *ne,
+			  LifeNode *sw, LifeNode *se, uint64_t cells)
+{
+	size_t h = hashNode(nw, ne, sw, se, cells) &
+		(universe->bucketCount - 1);
+
+	for (LifeNode *node = universe->buckets[h]; node; node = node->next) {
+		if (node->quadrant[NW] == nw && node->quadrant[NE] == ne &&
+		    node->quadrant[SW] == sw && node->quadrant[SE] == se &&
+		    node->cells == cells) {
+			return node;
+		}
+	}
+
+	LifeNode *node = allocateNode(universe);
+	if (node == NULL) {
+		return NULL;
+	}
+
+	node->quadrant[NW] = nw;
+	node->quadrant[NE] = ne;
+	node->quadrant[SW] = sw;
+	node->quadrant[SE] = se;
+	node->cells = cells;
+	node->result = NULL;
+	node->step = -1;
+	node->marked = 0;
+	if (nw == NULL) {
+		node->population = (uint64_t)__builtin_popcountll(cells);
+		node->level = LEAF_LEVEL;
+	} else {
+		// tiles of a torus can hold more cells than there are numbers.
+		uint64_t population = nw->population;
+		if (__builtin_add_overflow(population, ne->population,
+					   &population) ||
+		    __builtin_add_overflow(population, sw->population,
+					   &population) ||
+		    __builtin_add_overflow(population, se->population,
+					   &population)) {
+			population = UINT64_MAX;
+		}
+		node->population = population;
+		node->level = nw->level + 1;
+	}
+	node->next = universe->buckets[h];
+	universe->buckets[h] = node;
+
+	if (++universe->nodes > universe->bucketCount) {
+		growBuckets(universe);
+	}
+
+	return node;
+}
+
+/**
+ * @Return the node with the given quadrants, or NULL if one of them or
+ * the node itself could not be made
+ */
+static LifeNode *joinNodes(LifeUniverse *universe, LifeNode *nw,
+			   LifeNode *ne, LifeNode *sw, LifeNode *se)
+{
+	if (nw == NULL || ne == NULL || sw == NULL || se == NULL) {
+		return NULL;
+	}
+
+	return findNode(universe, nw, ne, sw, se, 0);
+}
+
+static LifeNode *leafNode(LifeUniverse *universe, uint64_t cells)
+{
+	return findNode(universe, NULL, NULL, NULL, NULL, cells);
+}
+
+/**
+ * @Return the node of the given level with no live cells, or NULL if it
+ * could not be made
+ */
+static LifeNode *emptyNode(LifeUniverse *universe, int level)
+{
+	if (universe->empty[level] == NULL) {
+		if (level == LEAF_LEVEL) {
+			universe->empty[level] = leafNode(universe, 0);
+		} else {
+			LifeNode *e = emptyNode(universe, level - 1);
+			universe->empty[level] = joinNodes(universe, e, e, e, e);
+		}
+	}
+
+	return universe->empty[level];
+}
+
+/**
+ * Lay out the four leaves of a node one level above them as 16 rows of
+ * 16 cells.
+ */
+static void spreadLeaves(LifeNode *node, uint32_t rows[16])
+{
+	for (int y = 0; y < 8; y++) {
+		int shift = y * 8;
+		rows[y] = ((node->quadrant[NW]->cells >> shift) & 0xff) |
+			((node->quadrant[NE]->cells >> shift) & 0xff) << 8;
+		rows[y + 8] = ((node->quadrant[SW]->cells >> shift) & 0xff) |
+			((node->quadrant[SE]->cells >> shift) & 0xff) << 8;
+	}
+}
+
+/**
+ * Make a leaf of the 8x8 cells in the middle of 16 rows.
+ */
+static LifeNode *gatherLeaf(LifeUniverse *universe, const uint32_t rows[16])
+{
+	uint64_t cells = 0;
+
+	for (int y = 0; y < 8; y++) {
+		cells |= (uint64_t)((rows[y + 4] >> 4) & 0xff) << (y * 8);
+	}
+
+	return leafNode(universe, cells);
+}
+
+/**
+ * @Return the centre half of a node, one level down, or NULL if it could
+ * not be made
+ */
+static LifeNode *centreNode(LifeUniverse *universe, LifeNode *node)
+{
+	if (node->level == LEAF_LEVEL + 1) {
+		uint32_t rows[16];
+		spreadLeaves(node, rows);
+		return gatherLeaf(universe, rows);
+	}
+
+	return joinNodes(universe,
+			 node->quadrant[NW]->quadrant[SE],
+			 node->quadrant[NE]->quadrant[SW],
+			 node->quadrant[SW]->quadrant[NE],
+			 node->quadrant[SE]->quadrant[NW]);
+}
+
+/**
+ * @Return a node one level up with this one in the middle, or NULL if it
+ * could not be made
+ */
+static LifeNode *expandNode(LifeUniverse *universe, LifeNode *node)
+{
+	LifeNode *e = emptyNode(universe, node->level - 1);
+
+	return joinNodes(universe,
+			 joinNodes(universe, e, e, e, node->quadrant[NW]),
+			 joinNodes(universe, e, e, node->quadrant[NE], e),
+			 joinNodes(universe, e, node->quadrant[SW], e, e),
+			 joinNodes(universe, node->quadrant[SE], e, e, e));
+}
+
+/**
+ * Advance the cells of rows 1 to 14 out of 16 by one generation; the
+ * cells along the edges come out wrong, as they are missing neighbours.
+ */
+static void advanceRows(uint32_t rows[16])
+{
+	uint32_t next[16] = { 0 };
+	boolean conway = lifeRule.birth == LIFE_CONWAY_BIRTH &&
+		lifeRule.survival == LIFE_CONWAY_SURVIVAL;
+	uint32_t leaf[2][9];
+
+	for (int c = 0; c < 9; c++) {
+		leaf[0][c] = (lifeRule.birth >> c) & 1 ? ~(uint32_t)0 : 0;
+		leaf[1][c] = (lifeRule.survival >> c) & 1 ? ~(uint32_t)0 : 0;
+	}
+
+	for (int y = 1; y < 15; y++) {
+		uint32_t a = rows[y - 1], m = rows[y], b = rows[y + 1];
+		uint32_t aW = a << 1, aE = a >> 1;
+		uint32_t mW = m << 1, mE = m >> 1;
+		uint32_t bW = b << 1, bE = b >> 1;
+
+		/* the same adders as the row kernels */
+		uint32_t aLow  = aW ^ a ^ aE;
+		uint32_t aHigh = (aW & a) | (aE & (aW ^ a));
+		uint32_t bLow  = bW ^ b ^ bE;
+		uint32_t bHigh = (bW & b) | (bE & (bW ^ b));
+		uint32_t mLow  = mW ^ mE;
+		uint32_t mHigh = mW & mE;
+		uint32_t s0 = aLow ^ bLow ^ mLow;
+		uint32_t c0 = (aLow & bLow) | (mLow & (aLow ^ bLow));
+		uint32_t x = aHigh ^ bHigh;
+		uint32_t z = mHigh ^ c0;
+		uint32_t s1 = x ^ z;
+		uint32_t s2 = (aHigh & bHigh) ^ (mHigh & c0) ^ (x & z);
+
+		if (conway) {
+			next[y] = s1 & ~s2 & (s0 | m);
+		} else {
+			uint32_t s3 = ((aHigh & bHigh) & (mHigh & c0)) |
+				((x & z) & ((aHigh & bHigh) ^ (mHigh & c0)));
+			next[y] = LIFE_RULE_NEXT(ROW_MUX, s0, s1, s2, s3, m);
+		}
+	}
+
+	(void)memcpy(rows, next, sizeof(next));
+}
+
+/**
+ * Advance a node of 16x16 cells by 2^step generations, up to four, with
+ * plain bit operations on its rows.
+ */
+static LifeNode *advanceLeaves(LifeUniverse *universe, LifeNode *node,
+			       int step)
+{
+	uint32_t rows[16];
+
+	spreadLeaves(node, rows);
+	for (int i = 0; i < (1 << step); i++) {
+		advanceRows(rows);
+	}
+
+	return gatherLeaf(universe, rows);
+}
+
+/**
+ * Calculate the centre half of a node advanced 2^step generations, where
+ * step is at most the level of the node less two.
+ *
+ * The node is cut into nine overlapping squares of half its size. At full
+ * speed each of those is advanced, and the results are put together into
+ * four squares that are advanced again; slower steps take the centres of
+ * the nine squares instead and leave all of the advancing to the four.
+ *
+ * @Return the result, or NULL if the node is or a node on the way could
+ * not be made
+ */
+static LifeNode *advanceNode(LifeUniverse *universe, LifeNode *node, int step)
+{
+	if (node == NULL) {
+		return NULL;
+	}
+	if (node->result != NULL && node->step == step) {
+		return node->result;
+	}
+
+	int level = node->level;
+	LifeNode *result = NULL;
+
+	if (node->population == 0) {
+		result = emptyNode(universe, level - 1);
+	} else if (level == LEAF_LEVEL + 1) {
+		result = advanceLeaves(universe, node, step);
+	} else {
+		LifeNode *nw = node->quadrant[NW];
+		LifeNode *ne = node->quadrant[NE];
+		LifeNode *sw = node->quadrant[SW];
+		LifeNode *se = node->quadrant[SE];
+		LifeNode *n[9];
+
+		n[0] = nw;
+		n[1] = joinNodes(universe, nw->quadrant[NE], ne->quadrant[NW],
+				 nw->quadrant[SE], ne->quadrant[SW]);
+		n[2] = ne;
+		n[3] = joinNodes(universe, nw->quadrant[SW], nw->quadrant[SE],
+				 sw->quadrant[NW], sw->quadrant[NE]);
+		n[4] = joinNodes(universe, nw->quadrant[SE], ne->quadrant[SW],
+				 sw->quadrant[NE], se->quadrant[NW]);
+		n[5] = joinNodes(universe, ne->quadrant[SW], ne->quadrant[SE],
+				 se->quadrant[NW], se->quadrant[NE]);
+		n[6] = sw;
+		n[7] = joinNodes(universe, sw->quadrant[NE], se->quadrant[NW],
+				 sw->quadrant[SE], se->quadrant[SW]);
+		n[8] = se;
+
+		boolean full = step == level - 2;
+		for (int i = 0; i < 9; i++) {
+			n[i] = full ? advanceNode(universe, n[i], step - 1) :
+				centreNode(universe, n[i]);
+		}
+
+		int next = full ? step - 1 : step;
+		result = joinNodes(universe,
+			advanceNode(universe, joinNodes(universe,
+				n[0], n[1], n[3], n[4]), next),
+			advanceNode(universe, joinNodes(universe,
+				n[1], n[2], n[4], n[5]), next),
+			advanceNode(universe, joinNodes(universe,
+				n[3], n[4], n[6], n[7]), next),
+			advanceNode(universe, joinNodes(universe,
+				n[4], n[5], n[7], n[8]), next));
+	}
+
+	if (result == NULL) {
+		return NULL;
+	}
+
+	node->result = result;
+	node->step = (signed char)step;
+
+	return result;
+}
+
+/**
+ * Mark a node and everything below it as in use.
+ */
+static void markNode(LifeNode *node)
+{
+	if (node->marked) {
+		return;
+	}
+
+	node->marked = 1;
+	if (node->level > LEAF_LEVEL) {
+		for (int i = 0; i < 4; i++) {
+			markNode(node->quadrant[i]);
+		}
+	}
+}
+
+/**
+ * Free every node that the root and the empty nodes do not need, and
+ * forget the results that point to them.
+ */
+static void collectNodes(LifeUniverse *universe)
+{
+	markNode(universe->root);
+	for (int i = 0; i <= MAX_LEVEL; i++) {
+		if (universe->empty[i] != NULL) {
+			markNode(universe->empty[i]);
+		}
+	}
+
+	for (size_t i = 0; i < universe->bucketCount; i++) {
+		LifeNode **link = &universe->buckets[i];
+		while (*link != NULL) {
+			LifeNode *node = *link;
+			if (node->marked) {
+				if (node->result != NULL &&
+				    !node->result->marked) {
+					node->result = NULL;
+				}
+				link = &node->next;
+				continue;
+			}
+
+			*link = node->next;
+			node->next = universe->free;
+			universe->free = node;
+			universe->nodes--;
+		}
+	}
+
+	// and clear the marks for the next time.
+	for (size_t i = 0; i < universe->bucketCount; i++) {
+		for (LifeNode *node = universe->buckets[i]; node;
+		     node = node->next) {
+			node->marked = 0;
+		}
+	}
+}
+
+/**
+ * Build the node of the given level with its north west corner at (x, y)
+ * on the board; cells outside the board are dead.
+ */
+static LifeNode *buildNode(LifeUniverse *universe, LifeBoard *board,
+			   long x, long y, int level)
+{
+	long size = 1L << level;
+	long boardSize = board->boardSize;
+
+	if (x >= boardSize || y >= boardSize || x + size <= 0 || y + size <= 0) {
+		return emptyNode(universe, level);
+	}
+
+	if (level == LEAF_LEVEL) {
+		// x is a multiple of 8, so the row of a leaf is one byte.
+		uint64_t cells = 0;
+		uint64_t keep = boardSize - x >= 8 ? 0xff :
+			((uint64_t)1 << (boardSize - x)) - 1;
+
+		for (int i = 0; i < 8; i++) {
+			if (y + i < 0 || y + i >= boardSize) {
+				continue;
+			}
+			uint64_t word = lifeRow(board, (int)(y + i))[x / 64];
+			cells |= ((word >> (x % 64)) & keep) << (i * 8);
+		}
+
+		return leafNode(universe, cells);
+	}
+
+	long half = size / 2;
+	return joinNodes(universe,
+			 buildNode(universe, board, x, y, level - 1),
+			 buildNode(universe, board, x + half, y, level - 1),
+			 buildNode(universe, board, x, y + half, level - 1),
+			 buildNode(universe, board, x + half, y + half,
+				   level - 1));
+}
+
+/**
+ * Create a universe holding the cells of a board. Rules where dead cells
+ * are born with no neighbours cannot be run, as the space around the
+ * cells would not stay empty.
+ *
+ * @Return the universe, or NULL if out of memory or the rule has B0
+ */
+LifeUniverse *createUniverse(LifeBoard *board, size_t maxNodes)
+{
+	if (board == NULL || (lifeRule.birth & 1)) {
+		return NULL;
+	}
+
+	LifeUniverse *universe = (LifeUniverse *)calloc(1, sizeof(LifeUniverse));
+	if (universe == NULL) {
+		return NULL;
+	}
+
+	universe->bucketCount = MIN_BUCKETS;
+	universe->buckets = (LifeNode **)calloc(MIN_BUCKETS, sizeof(LifeNode *));
+	universe->maxNodes = maxNodes;
+	universe->limit = SIZE_MAX;
+	universe->boardSize = board->boardSize;
+	if (universe->buckets == NULL) {
+		destroyUniverse(universe);
+		return NULL;
+	}
+
+	// a power of two can be wrapped around by tiling the board.
+	int level = 0;
+	while ((1L << level) < board->boardSize) {
+		level++;
+	}
+	universe->torus = (1L << level) == board->boardSize &&
+		level > LEAF_LEVEL;
+
+	if (universe->torus) {
+		universe->root = buildNode(universe, board, 0, 0, level);
+	} else {
+		// room for the board on either side of the centre.
+		level = level < LEAF_LEVEL ? LEAF_LEVEL + 1 : level + 1;
+		long corner = -(1L << (level - 1));
+		universe->root = buildNode(universe, board, corner, corner,
+					   level);
+	}
+
+	if (universe->root == NULL) {
+		destroyUniverse(universe);
+		return NULL;
+	}
+
+	return universe;
+}
+
+/**
+ *
+ *
+ */
+void destroyUniverse(LifeUniverse *universe)
+{
+	if (universe == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < universe->blockCount; i++) {
+		free(universe->blocks[i]);
+	}
+	free(universe->blocks);
+	free(universe->buckets);
+	free(universe);
+}
+
+/**
+ * Advance a torus by 2^step generations. Copies of the torus side by side
+ * are the same torus wherever they are cut, so the root is tiled up to a
+ * square that can be advanced that far at once, and the torus is cut back
+ * out of the result.
+ *
+ * @Return the new root, or NULL if a node could not be made
+ */
+static LifeNode *advanceTorus(LifeUniverse *universe, int step)
+{
+	LifeNode *root = universe->root;
+	LifeNode *tiled = root;
+
+	do {
+		tiled = joinNodes(universe, tiled, tiled, tiled, tiled);
+	} while (tiled != NULL && tiled->level < step + 2);
+
+	LifeNode *result = advanceNode(universe, tiled, step);
+	if (result == NULL) {
+		return NULL;
+	}
+
+	// the result starts a quarter of the tiles in, which is a whole
+	// number of tori once there are more than two of them across.
+	int shift = tiled->level - 2;
+	if (shift < root->level) {
+		universe->origin = (universe->origin + (1 << shift)) %
+			universe->boardSize;
+	}
+	while (result->level > root->level) {
+		result = result->quadrant[NW];
+	}
+
+	return result;
+}
+
+/**
+ * Advance a plane by 2^step generations, growing the root until nothing
+ * in it can reach its edge in the time.
+ *
+ * @Return the new root, or NULL if a node could not be made or the root
+ * would grow past MAX_LEVEL
+ */
+static LifeNode *advancePlane(LifeUniverse *universe, int step)
+{
+	LifeNode *root = universe->root;
+
+	for (;;) {
+		if (root->level >= step + 2) {
+			LifeNode *centre = centreNode(universe, root);
+			if (centre == NULL) {
+				return NULL;
+			}
+			if (centre->population == root->population) {
+				break;
+			}
+		}
+
+		// the root is expanded once more to be advanced.
+		if (root->level + 2 > MAX_LEVEL) {
+			return NULL;
+		}
+		root = expandNode(universe, root);
+		if (root == NULL) {
+			return NULL;
+		}
+	}
+
+	return advanceNode(universe, expandNode(universe, root), step);
+}
+
+/**
+ * Advance the universe by 2^step generations, in two halves if the step
+ * is exhausted, or too long to tile a torus for.
+ *
+ * @Return false if even the smallest steps are exhausted, or a plane
+ * would grow past MAX_LEVEL, leaving the universe part of the way there
+ */
+boolean advanceUniverse(LifeUniverse *universe, int step)
+{
+	if (universe == NULL || step < 0) {
+		return false;
+	}
+
+	if (universe->torus && step + 2 > MAX_LEVEL) {
+		return advanceUniverse(universe, step - 1) &&
+			advanceUniverse(universe, step - 1);
+	}
+
+	universe->limit = universe->nodes + universe->maxNodes;
+	universe->exhausted = false;
+	LifeNode *root = universe->torus ? advanceTorus(universe, step) :
+		advancePlane(universe, step);
+	universe->limit = SIZE_MAX;
+
+	if (root == NULL) {
+		// start over with only what the root needs.
+		collectNodes(universe);
+		return universe->exhausted && step > 0 &&
+			advanceUniverse(universe, step - 1) &&
+			advanceUniverse(universe, step - 1);
+	}
+
+	universe->root = root;
+	universe->generation += (uint64_t)1 << step;
+
+	if (universe->nodes > universe->maxNodes) {
+		collectNodes(universe);
+	}
+
+	return true;
+}
+
+/**
+ * Advance the universe by any number of generations, a power of two at a
+ * time.
+ *
+ * @Return false if it could not be advanced all the way, see
+ * advanceUniverse
+ */
+boolean jumpUniverse(LifeUniverse *universe, uint64_t generations)
+{
+	for (int step = 63; step >= 0; step--) {
+		if ((generations & ((uint64_t)1 << step)) &&
+		    !advanceUniverse(universe, step)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Set the live cells of a node with its north west corner at (x, y) on
+ * the board, wrapping around for a torus.
+ */
+static void writeNode(LifeUniverse *universe, LifeNode *node, LifeBoard *board,
+		      long x, long y)
+{
+	long size = 1L << node->level;
+	long boardSize = board->boardSize;
+
+	if (node->population == 0) {
+		return;
+	}
+	if (universe->torus) {
+		x %= boardSize;
+		y %= boardSize;
+	} else if (x >= boardSize || y >= boardSize ||
+		   x + size <= 0 || y + size <= 0) {
+		return;
+	}
+
+	if (node->level == LEAF_LEVEL) {
+		uint64_t keep = boardSize - x >= 8 ? 0xff :
+			((uint64_t)1 << (boardSize - x)) - 1;
+
+		for (int i = 0; i < 8; i++) {
+			if (y + i < 0 || y + i >= boardSize) {
+				continue;
+			}
+			uint64_t bits = (node->cells >> (i * 8)) & keep;
+			lifeRow(board, (int)(y + i))[x / 64] |= bits << (x % 64);
+		}
+		return;
+	}
+
+	long half = size / 2;
+	writeNode(universe, node->quadrant[NW], board, x, y);
+	writeNode(universe, node->quadrant[NE], board, x + half, y);
+	writeNode(universe, node->quadrant[SW], board, x, y + half);
+	writeNode(universe, node->quadrant[SE], board, x + half, y + half);
+}
+
+/**
+ * Copy the cells of the universe back to a board of the same size; for a
+ * plane, the cells that have moved off the board are lost.
+ */
+void copyUniverseToBoard(LifeUniverse *universe, LifeBoard *board)
+{
+	if (universe == NULL || board == NULL ||
+	    board->boardSize != universe->boardSize) {
+		return;
+	}
+
+	for (int y = 0; y < board->boardSize; y++) {
+		(void)memset(lifeRow(board, y), 0x0,
+			     sizeof(uint64_t) * board->words);
+	}
+
+	LifeNode *root = universe->root;
+	if (universe->torus) {
+		writeNode(universe, root, board, universe->origin,
+			  universe->origin);
+	} else {
+		long corner = -(1L << (root->level - 1));
+		writeNode(universe, root, board, corner, corner);
+	}
+
+	markBoardChanged(board);
+}
+
+/**
+ * Advance a board by any number of generations through a universe of its
+ * own, leaving it as it was if it could not be.
+ *
+ * @Return false if there was not enough memory for the universe or the
+ * jump, a plane would grow too large for it, or the rule has B0
+ */
+boolean jumpBoard(LifeBoard *board, uint64_t generations, size_t maxNodes)
+{
+	LifeUniverse *universe = createUniverse(board, maxNodes);
+
+	if (universe == NULL) {
+		return false;
+	}
+
+	if (!jumpUniverse(universe, generations)) {
+		destroyUniverse(universe);
+		return false;
+	}
+	copyUniverseToBoard(universe, board);
+	destroyUniverse(universe);
+
+	return true;
+}
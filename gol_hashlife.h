@@ -0,0 +1,103 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_HASHLIFE_H_
+#define __GOL_HASHLIFE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gol_backend.h"
+
+/*
+ * A node of the quadtree covers a square of 2^level cells on a side, and
+ * is canonical: there is only ever one node with the same four quadrants,
+ * so equal squares anywhere in space and time share a node, and the
+ * result of advancing one has to be calculated only once. The leaves are
+ * squares of 8x8 cells, held as a bitmap with cell (x, y) in bit
+ * y * 8 + x.
+ *
+ * The result is the centre half of the square, advanced 2^step
+ * generations, which is as far as nothing outside the square can reach.
+ */
+typedef struct LifeNode
+{
+	struct LifeNode *quadrant[4];
+	struct LifeNode *result;
+	struct LifeNode *next;
+	uint64_t cells;
+	uint64_t population;
+	signed char level;
+	signed char step;
+	unsigned char marked;
+} LifeNode;
+
+/* Quadrants, with y growing southwards as on the board. */
+#define NW 0
+#define NE 1
+#define SW 2
+#define SE 3
+
+#define LEAF_LEVEL 3
+
+/* The largest square there can be, so that its corner fits in a long. */
+#define MAX_LEVEL 62
+
+/*
+ * A universe to run HashLife on, made from a board. If the board size is a
+ * power of two the universe wraps around like a torus, with the root
+ * shifted by origin cells from the board; otherwise it is the board
+ * placed on an infinite plane of dead cells, centred on the root.
+ *
+ * The node cache is garbage collected down to what the root needs once it
+ * grows past maxNodes, which is checked between steps. A step may make no
+ * more than maxNodes nodes on top of those it started with, up to limit;
+ * one that needs more, or that runs out of memory, is exhausted, and is
+ * taken again in two halves after collecting.
+ */
+typedef struct LifeUniverse
+{
+	LifeNode *root;
+	LifeNode *empty[MAX_LEVEL + 1];
+	LifeNode **buckets;
+	LifeNode *free;
+	void **blocks;
+	size_t bucketCount;
+	size_t blockCount;
+	size_t nodes;
+	size_t maxNodes;
+	size_t limit;
+	boolean exhausted;
+	int boardSize;
+	boolean torus;
+	int origin;
+	uint64_t generation;
+} LifeUniverse;
+
+LifeUniverse *createUniverse(LifeBoard *, size_t);
+void destroyUniverse(LifeUniverse *);
+boolean advanceUniverse(LifeUniverse *, int);
+boolean jumpUniverse(LifeUniverse *, uint64_t);
+void copyUniverseToBoard(LifeUniverse *, LifeBoard *);
+boolean jumpBoard(LifeBoard *, uint64_t, size_t);
+
+#endif
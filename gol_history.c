@@ -0,0 +1,475 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_arena.h"
+#include "gol_history.h"
+
+#define MIN_ENTRIES  64
+
+// the part of the budget that goes to the entries rather than the ring.
+#define ENTRY_SHARE  8
+#define MIN_ZERO_RUN 3
+
+/**
+ * Append a number in seven bit groups, lowest first, with the top bit set
+ * on all but the last.
+ */
+static size_t putNumber(unsigned char *out, size_t length, size_t number)
+{
+	while (number >= 0x80) {
+		out[length++] = (unsigned char)(number | 0x80);
+		number >>= 7;
+	}
+	out[length++] = (unsigned char)number;
+
+	return length;
+}
+
+/**
+ * Read a number written by putNumber.
+ */
+static size_t getNumber(const unsigned char *data, size_t *position)
+{
+	size_t number = 0;
+	int shift = 0;
+	unsigned char byte;
+
+	do {
+		byte = data[(*position)++];
+		number |= (size_t)(byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	return number;
+}
+
+/**
+ * Run length encode bytes, each of them XORed with the same byte of base
+ * unless base is NULL. Every run is the number of zero bytes and then the
+ * number of bytes following them, then those bytes; zeros at the end are
+ * left out. Gaps of fewer than MIN_ZERO_RUN zeros cost less kept in.
+ *
+ * @Return the number of bytes written to out, which has room for
+ * 2 * count + 16 bytes, more than this can take
+ */
+size_t encodeDelta(const unsigned char *bytes, const unsigned char *base,
+		   size_t count, unsigned char *out)
+{
+	size_t length = 0;
+	size_t i = 0;
+
+#define DIFF(i) (bytes[i] ^ (base ? base[i] : 0))
+	for (;;) {
+		size_t start = i;
+		while (i < count && DIFF(i) == 0) {
+			i++;
+		}
+		if (i == count) {
+			break;
+		}
+
+		size_t literal = i;
+		size_t end = i;
+		for (int gap = 0; i < count && gap < MIN_ZERO_RUN; i++) {
+			if (DIFF(i) != 0) {
+				end = i + 1;
+				gap = 0;
+			} else {
+				gap++;
+			}
+		}
+
+		length = putNumber(out, length, literal - start);
+		length = putNumber(out, length, end - literal);
+		for (i = literal; i < end; i++) {
+			out[length++] = (unsigned char)DIFF(i);
+		}
+	}
+#undef DIFF
+
+	return length;
+}
+
+/**
+ * XOR run length encoded bytes into bytes.
+ */
+void decodeDelta(const unsigned char *data, size_t length,
+		 unsigned char *bytes)
+{
+	size_t i = 0;
+
+	for (size_t d = 0; d < length;) {
+		i += getNumber(data, &d);
+		for (size_t n = getNumber(data, &d); n > 0; n--) {
+			bytes[i++] ^= data[d++];
+		}
+	}
+}
+
+/**
+ * Copy the words of a board into one run, clearing the bits past its
+ * edge.
+ */
+static void readBoard(LifeHistory *history, LifeBoard *board, uint64_t *out)
+{
+	int tail = history->boardSize % 64;
+	uint64_t mask = tail ? ((uint64_t)1 << tail) - 1 : ~(uint64_t)0;
+
+	for (int y = 0; y < history->boardSize; y++) {
+		uint64_t *row = out + (size_t)y * history->words;
+		(void)memcpy(row, lifeRow(board, y),
+			     sizeof(uint64_t) * history->words);
+		row[history->words - 1] &= mask;
+	}
+}
+
+/**
+ * Copy one run of words back into a board.
+ */
+static void writeBoard(LifeHistory *history, const uint64_t *words,
+		       LifeBoard *board)
+{
+	for (int y = 0; y < history->boardSize; y++) {
+		(void)memcpy(lifeRow(board, y),
+			     words + (size_t)y * history->words,
+			     sizeof(uint64_t) * history->words);
+	}
+
+	markBoardChanged(board);
+}
+
+/**
+ * Create an empty history for boards of the same size as the given one,
+ * keeping no more than budget bytes of entries, with four boards of
+ * working space on top.
+ *
+ * @Return the history, or NULL if out of memory
+ */
+LifeHistory *createHistory(LifeBoard *board, size_t budget, int keyInterval)
+{
+	if (board == NULL || keyInterval <= 0) {
+		return NULL;
+	}
+
+	LifeHistory *history = (LifeHistory *)calloc(1, sizeof(LifeHistory));
+	if (history == NULL) {
+		return NULL;
+	}
+
+	history->budget = budget;
+	history->keyInterval = keyInterval;
+	history->boardSize = board->boardSize;
+	history->words = board->words;
+	history->boardWords = (size_t)board->words * board->boardSize;
+	// the budget is split between the entries and the ring.
+	history->space = budget / ENTRY_SHARE / sizeof(LifeHistoryEntry);
+	if (history->space < MIN_ENTRIES) {
+		history->space = MIN_ENTRIES;
+	}
+	size_t entryBytes = sizeof(LifeHistoryEntry) * history->space;
+	history->ringSize = budget > entryBytes ? budget - entryBytes : 0;
+
+	size_t boardBytes = sizeof(uint64_t) * history->boardWords;
+	size_t scratchBytes = 2 * boardBytes + 16;
+	history->arena = createArena(2 * boardBytes + scratchBytes +
+				     entryBytes + history->ringSize +
+				     5 * LIFE_CACHE_LINE);
+	if (history->arena == NULL) {
+		destroyHistory(history);
+		return NULL;
+	}
+
+	history->entries = (LifeHistoryEntry *)allocateArena(history->arena,
+		entryBytes, LIFE_CACHE_LINE);
+	history->current = (uint64_t *)allocateArena(history->arena,
+						      boardBytes, LIFE_CACHE_LINE);
+	history->next = (uint64_t *)allocateArena(history->arena, boardBytes,
+						   LIFE_CACHE_LINE);
+	history->scratch = (unsigned char *)allocateArena(history->arena,
+							  scratchBytes,
+							  LIFE_CACHE_LINE);
+	history->ring = (unsigned char *)allocateArena(history->arena,
+						       history->ringSize,
+						       LIFE_CACHE_LINE);
+
+	return history;
+}
+
+/**
+ * Free a history and all of its entries.
+ */
+void destroyHistory(LifeHistory *history)
+{
+	if (history == NULL) {
+		return;
+	}
+
+	destroyArena(history->arena);
+	free(history);
+}
+
+/**
+ * Drop the entries from index on.
+ */
+static void truncateHistory(LifeHistory *history, size_t index)
+{
+	for (size_t i = index; i < history->count; i++) {
+		history->bytes -= history->entries[i].length;
+	}
+	history->count = index;
+}
+
+/**
+ * Drop the oldest keyframe and the deltas that depend on it, if there is a
+ * newer keyframe to keep.
+ *
+ * @Return false if there is not
+ */
+static boolean dropOldest(LifeHistory *history)
+{
+	size_t next = 1;
+	while (next < history->count && !history->entries[next].keyframe) {
+		next++;
+	}
+	if (next >= history->count) {
+		return false;
+	}
+
+	for (size_t i = 0; i < next; i++) {
+		history->bytes -= history->entries[i].length;
+	}
+	history->count -= next;
+	(void)memmove(history->entries, history->entries + next,
+		      sizeof(LifeHistoryEntry) * history->count);
+
+	return true;
+}
+
+/**
+ * Find room for an entry of length bytes in the ring, after the newest
+ * entry, or at the start if that is past the oldest one and there is no
+ * room left at the end. The newest entry never quite catches up with the
+ * oldest, so a full ring can be told from an empty one.
+ *
+ * @Return where the entry goes, or NULL if the ring is full
+ */
+static unsigned char *allocateEntry(LifeHistory *history, size_t length)
+{
+	if (history->count == 0) {
+		return length <= history->ringSize ? history->ring : NULL;
+	}
+
+	LifeHistoryEntry *newest = &history->entries[history->count - 1];
+	size_t head = (size_t)(history->entries[0].data - history->ring);
+	size_t tail = (size_t)(newest->data - history->ring) + newest->length;
+
+	if (tail >= head) {
+		if (history->ringSize - tail >= length) {
+			return history->ring + tail;
+		}
+		return head > length ? history->ring : NULL;
+	}
+
+	return head - tail > length ? history->ring + tail : NULL;
+}
+
+/**
+ * Record the board as the given generation, dropping any recorded
+ * generations from it on, left over from before stepping back. It is
+ * stored as a delta when the generation before it is the last one
+ * recorded or sought to, and a keyframe otherwise.
+ */
+void recordGeneration(LifeHistory *history, LifeBoard *board,
+		      unsigned long long generation)
+{
+	if (history == NULL || board == NULL ||
+	    board->boardSize != history->boardSize) {
+		return;
+	}
+
+	// the recorded generations are in order.
+	size_t index = history->count;
+	while (index > 0 && history->entries[index - 1].generation >= generation) {
+		index--;
+	}
+	truncateHistory(history, index);
+
+	// a keyframe every keyInterval entries bounds the cost of a seek.
+	size_t key = index;
+	while (key > 0 && !history->entries[key - 1].keyframe) {
+		key--;
+	}
+	boolean keyframe = index == 0 || !history->valid ||
+		history->generation != generation - 1 ||
+		history->entries[index - 1].generation != generation - 1 ||
+		index - key + 1 >= (size_t)history->keyInterval;
+
+	readBoard(history, board, history->next);
+	size_t length = encodeDelta((unsigned char *)history->next,
+				    keyframe ? NULL :
+				    (unsigned char *)history->current,
+				    sizeof(uint64_t) * history->boardWords,
+				    history->scratch);
+
+	uint64_t *current = history->current;
+	history->current = history->next;
+	history->next = current;
+	history->generation = generation;
+	history->valid = true;
+
+	// make room for the entry and in the ring from the oldest end, or
+	// failing that start over from this generation as a keyframe.
+	unsigned char *data = NULL;
+	while ((history->count == history->space ||
+		(data = allocateEntry(history, length)) == NULL) &&
+	       dropOldest(history)) {
+	}
+	if (data == NULL) {
+		truncateHistory(history, 0);
+		if (!keyframe) {
+			keyframe = true;
+			length = encodeDelta((unsigned char *)history->current,
+					     NULL, sizeof(uint64_t) *
+					     history->boardWords,
+					     history->scratch);
+		}
+		data = allocateEntry(history, length);
+	}
+	if (data == NULL || history->count == history->space) {
+		// out of room; start over from the next keyframe.
+		history->valid = false;
+		return;
+	}
+
+	(void)memcpy(data, history->scratch, length);
+	LifeHistoryEntry *entry = &history->entries[history->count++];
+	entry->generation = generation;
+	entry->keyframe = keyframe;
+	entry->length = length;
+	entry->data = data;
+	history->bytes += length;
+}
+
+/**
+ * Find the entry of a generation.
+ *
+ * @Return its index, or count if it is not there
+ */
+static size_t findEntry(LifeHistory *history, unsigned long long generation)
+{
+	size_t low = 0;
+	size_t high = history->count;
+
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (history->entries[middle].generation < generation) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	if (low < history->count &&
+	    history->entries[low].generation == generation) {
+		return low;
+	}
+
+	return history->count;
+}
+
+/**
+ * Put a recorded generation on the board, undoing deltas from the current
+ * one if it is close by, and applying them from the nearest keyframe
+ * before it otherwise.
+ *
+ * @Return false if the generation is not in the history
+ */
+boolean seekGeneration(LifeHistory *history, LifeBoard *board,
+		       unsigned long long generation)
+{
+	if (history == NULL || board == NULL ||
+	    board->boardSize != history->boardSize) {
+		return false;
+	}
+
+	size_t target = findEntry(history, generation);
+	if (target == history->count) {
+		return false;
+	}
+
+	size_t key = target;
+	while (!history->entries[key].keyframe) {
+		key--;
+	}
+
+	size_t current = history->valid ?
+		findEntry(history, history->generation) : history->count;
+	boolean backwards = current < history->count && current >= target &&
+		current - target <= target - key;
+	for (size_t i = target + 1; backwards && i <= current; i++) {
+		backwards = !history->entries[i].keyframe;
+	}
+
+	if (backwards) {
+		for (size_t i = current; i > target; i--) {
+			decodeDelta(history->entries[i].data,
+				    history->entries[i].length,
+				    (unsigned char *)history->current);
+		}
+	} else {
+		(void)memset(history->current, 0x0,
+			     sizeof(uint64_t) * history->boardWords);
+		for (size_t i = key; i <= target; i++) {
+			decodeDelta(history->entries[i].data,
+				    history->entries[i].length,
+				    (unsigned char *)history->current);
+		}
+	}
+
+	history->generation = generation;
+	history->valid = true;
+	writeBoard(history, history->current, board);
+
+	return true;
+}
+
+/**
+ * Get the oldest and newest generations in the history.
+ *
+ * @Return false if it is empty
+ */
+boolean getHistoryRange(LifeHistory *history, unsigned long long *oldest,
+			unsigned long long *newest)
+{
+	if (history == NULL || history->count == 0) {
+		return false;
+	}
+
+	*oldest = history->entries[0].generation;
+	*newest = history->entries[history->count - 1].generation;
+
+	return true;
+}
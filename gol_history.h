@@ -0,0 +1,92 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_HISTORY_H_
+#define __GOL_HISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gol_backend.h"
+
+/*
+ * A recorded generation, as the bytes of the board run length encoded
+ * either on their own, for a keyframe, or XORed with the generation
+ * recorded before it, for a delta. Runs of zero bytes are stored as their
+ * length, so a delta costs about as much as what changed.
+ */
+typedef struct LifeHistoryEntry
+{
+	unsigned long long generation;
+	boolean keyframe;
+	size_t length;
+	unsigned char *data;
+} LifeHistoryEntry;
+
+/*
+ * The generations recorded so far, in order, starting with a keyframe and
+ * with another one at least every keyInterval generations. The budget
+ * holds both the space entries of them and the ring of ringSize bytes
+ * they are kept in one after the other, added at the newest end and
+ * dropped from either end. When either is full the oldest keyframe is
+ * dropped together with the deltas after it until the next entry fits.
+ *
+ * Along with the boards below, the entries and the ring are allocated
+ * once, from an arena of the history's own, so recording does not
+ * allocate and memory does not fragment however long it goes on, and the
+ * history never takes more than the budget and those boards.
+ *
+ * The state of the generation last recorded or sought to is kept in
+ * current, so stepping back one generation only has to undo one delta.
+ */
+typedef struct LifeHistory
+{
+	LifeHistoryEntry *entries;
+	size_t count;
+	size_t space;
+	size_t bytes;
+	size_t budget;
+	int keyInterval;
+	int boardSize;
+	int words;
+	size_t boardWords;
+	struct LifeArena *arena;
+	unsigned char *ring;
+	size_t ringSize;
+	uint64_t *current;
+	uint64_t *next;
+	unsigned char *scratch;
+	unsigned long long generation;
+	boolean valid;
+} LifeHistory;
+
+LifeHistory *createHistory(LifeBoard *, size_t, int);
+void destroyHistory(LifeHistory *);
+void recordGeneration(LifeHistory *, LifeBoard *, unsigned long long);
+boolean seekGeneration(LifeHistory *, LifeBoard *, unsigned long long);
+boolean getHistoryRange(LifeHistory *, unsigned long long *,
+			unsigned long long *);
+size_t encodeDelta(const unsigned char *, const unsigned char *, size_t,
+		   unsigned char *);
+void decodeDelta(const unsigned char *, size_t, unsigned char *);
+
+#endif
@@ -0,0 +1,764 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIFE_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * The next generation of the words at index w, written once for all word
+ * and vector types in terms of the operations given.
+ *
+ * The eight neighbours of every cell are lined up by shifting in the bits
+ * from the words next door, and counted in parallel with full and half
+ * adders into the bit planes of the count.
+ *
+ * The rules for the game of life are :
+ *
+ * Any live cell with fewer than two neighbors dies of loneliness.
+ * Any live cell with more than three neighbors dies of crowding.
+ * Any dead cell with exactly three neighbors comes to life.
+ * Any live cell with two or three neighbors lives, unchanged, to the
+ * next generation.
+ *
+ * NEXT gives the new cells from the bit planes s0 to s3 of the count and
+ * the cells themselves, where s3 is only worked out if it is used. The
+ * *_CONWAY ones are for Conway's rules, B3/S23, which never need s3: a
+ * count of two or three has bit 1 set and bit 2 cleared, which leaves
+ * bit 0 to tell them apart, and eight neighbours is just as dead as none.
+ * Every other rule goes through LIFE_RULE_NEXT, which looks the count up
+ * in the table of the rule in use.
+ *
+ * The words being overwritten are compared with the new ones on the way
+ * out, to flag the tiles that changed, and COUNT is handed the new words
+ * and the old ones of the row, for the count kernels to count.
+ */
+#define LIFE_KERNEL_WORDS(V, LOAD, STORE, AND, OR, XOR, XOR3, MAJ, ANDN,	\
+			  SHL, SHR, CHANGED, NEXT, COUNT)			\
+	do {								\
+		V a  = LOAD(above + w);					\
+		V aW = OR(SHL(a, 1), SHR(LOAD(above + w - 1), 63));	\
+		V aE = OR(SHR(a, 1), SHL(LOAD(above + w + 1), 63));	\
+		V m  = LOAD(row + w);					\
+		V mW = OR(SHL(m, 1), SHR(LOAD(row + w - 1), 63));	\
+		V mE = OR(SHR(m, 1), SHL(LOAD(row + w + 1), 63));	\
+		V b  = LOAD(below + w);					\
+		V bW = OR(SHL(b, 1), SHR(LOAD(below + w - 1), 63));	\
+		V bE = OR(SHR(b, 1), SHL(LOAD(below + w + 1), 63));	\
+									\
+		V aLow  = XOR3(aW, a, aE);				\
+		V aHigh = MAJ(aW, a, aE);				\
+		V bLow  = XOR3(bW, b, bE);				\
+		V bHigh = MAJ(bW, b, bE);				\
+		V mLow  = XOR(mW, mE);					\
+		V mHigh = AND(mW, mE);					\
+									\
+		V s0 = XOR3(aLow, bLow, mLow);				\
+		V c0 = MAJ(aLow, bLow, mLow);				\
+		V x  = XOR(aHigh, bHigh);				\
+		V y  = XOR(mHigh, c0);					\
+		V s1 = XOR(x, y);					\
+		V s2 = XOR3(AND(aHigh, bHigh), AND(mHigh, c0), AND(x, y)); \
+									\
+		V next = NEXT(s0, s1, s2,				\
+			      MAJ(AND(aHigh, bHigh), AND(mHigh, c0), AND(x, y)), \
+			      m);					\
+		V diff = XOR(LOAD(out + w), next);			\
+		STORE(out + w, next);					\
+		changes[w / LIFE_TILE_WORDS] |= CHANGED(diff);		\
+		COUNT(next, m);						\
+	} while (0)
+
+/*
+ * Add the live cells among the new words at index w, and the cells where
+ * they differ from the old ones, to the counts of their tile. Each word of
+ * the tile has a count of its own, so that a vector adds to its counts
+ * with one vector, and they are only added up once the tile is done.
+ */
+#define LIFE_COUNT_CELLS(LOAD, STORE, ADD, XOR, POPCOUNT, next, m)	\
+	do {								\
+		uint64_t *count = counts + w / LIFE_TILE_WORDS *	\
+			LIFE_COUNT_WORDS + w % LIFE_TILE_WORDS;		\
+		uint64_t *flips = count + LIFE_TILE_WORDS;		\
+		STORE(count, ADD(LOAD(count), POPCOUNT(next)));		\
+		STORE(flips, ADD(LOAD(flips), POPCOUNT(XOR(next, m))));	\
+	} while (0)
+
+#define LIFE_NO_COUNT(next, m)	((void)0)
+
+/* The lookup table of the rule in use, for dead and live cells. */
+static uint64_t ruleLeaves[2][9] = {
+	{ [3] = ~(uint64_t)0 },
+	{ [2] = ~(uint64_t)0, [3] = ~(uint64_t)0 },
+};
+
+#define S_LOAD(p)		(*(p))
+#define S_STORE(p, v)		(*(p) = (v))
+#define S_AND(a, b)		((a) & (b))
+#define S_OR(a, b)		((a) | (b))
+#define S_XOR(a, b)		((a) ^ (b))
+#define S_XOR3(a, b, c)		((a) ^ (b) ^ (c))
+#define S_MAJ(a, b, c)		(((a) & (b)) | ((c) & ((a) ^ (b))))
+#define S_ANDN(a, b)		(~(a) & (b))
+#define S_MUX(s, a, b)		((a) ^ (((a) ^ (b)) & (s)))
+#define S_SHL(a, n)		((a) << (n))
+#define S_SHR(a, n)		((a) >> (n))
+#define S_CHANGED(d)		((d) != 0)
+#define S_CONWAY(s0, s1, s2, s3, m) S_ANDN(s2, S_AND(s1, S_OR(s0, m)))
+#define S_RULE(s0, s1, s2, s3, m) LIFE_RULE_NEXT(S_MUX, s0, s1, s2, s3, m)
+#define S_ADD(a, b)		((a) + (b))
+#define S_COUNT(next, m)	LIFE_COUNT_CELLS(S_LOAD, S_STORE, S_ADD, S_XOR, \
+						 __builtin_popcountll, next, m)
+
+/**
+ * Reference kernel, one word at a time. Also used for the words left over
+ * at the end of a row by the vector kernels.
+ */
+static void calculateRowScalar(const uint64_t *above, const uint64_t *row,
+			       const uint64_t *below, uint64_t *out, int words,
+			       unsigned char *changes)
+{
+	for (int w = 0; w < words; w++) {
+		LIFE_KERNEL_WORDS(uint64_t, S_LOAD, S_STORE, S_AND, S_OR,
+				  S_XOR, S_XOR3, S_MAJ, S_ANDN, S_SHL, S_SHR,
+				  S_CHANGED, S_CONWAY, LIFE_NO_COUNT);
+	}
+}
+
+/**
+ * Reference kernel for any rule.
+ */
+static void calculateRuleScalar(const uint64_t *above, const uint64_t *row,
+				const uint64_t *below, uint64_t *out, int words,
+				unsigned char *changes)
+{
+	const uint64_t (*leaf)[9] = ruleLeaves;
+
+	for (int w = 0; w < words; w++) {
+		LIFE_KERNEL_WORDS(uint64_t, S_LOAD, S_STORE, S_AND, S_OR,
+				  S_XOR, S_XOR3, S_MAJ, S_ANDN, S_SHL, S_SHR,
+				  S_CHANGED, S_RULE, LIFE_NO_COUNT);
+	}
+}
+
+/**
+ * Reference count kernel. Also used for the words left over at the end of
+ * a row by the vector count kernels.
+ */
+static void countRowScalar(const uint64_t *above, const uint64_t *row,
+			   const uint64_t *below, uint64_t *out, int words,
+			   unsigned char *changes, uint64_t *counts)
+{
+	for (int w = 0; w < words; w++) {
+		LIFE_KERNEL_WORDS(uint64_t, S_LOAD, S_STORE, S_AND, S_OR,
+				  S_XOR, S_XOR3, S_MAJ, S_ANDN, S_SHL, S_SHR,
+				  S_CHANGED, S_CONWAY, S_COUNT);
+	}
+}
+
+/**
+ * Reference count kernel for any rule.
+ */
+static void countRuleScalar(const uint64_t *above, const uint64_t *row,
+			    const uint64_t *below, uint64_t *out, int words,
+			    unsigned char *changes, uint64_t *counts)
+{
+	const uint64_t (*leaf)[9] = ruleLeaves;
+
+	for (int w = 0; w < words; w++) {
+		LIFE_KERNEL_WORDS(uint64_t, S_LOAD, S_STORE, S_AND, S_OR,
+				  S_XOR, S_XOR3, S_MAJ, S_ANDN, S_SHL, S_SHR,
+				  S_CHANGED, S_RULE, S_COUNT);
+	}
+}
+
+#ifdef LIFE_KERNEL_X86
+
+/* Broadcast the lookup table into vectors before the loop. */
+#define LIFE_RULE_LEAVES(V, SET1)					\
+	V leaf[2][9];							\
+	for (int i = 0; i < 2; i++) {					\
+		for (int c = 0; c < 9; c++) {				\
+			leaf[i][c] = SET1((long long)ruleLeaves[i][c]);	\
+		}							\
+	}
+
+#define X128_LOAD(p)		_mm_loadu_si128((const __m128i *)(p))
+#define X128_STORE(p, v)	_mm_storeu_si128((__m128i *)(p), (v))
+#define X128_AND(a, b)		_mm_and_si128((a), (b))
+#define X128_OR(a, b)		_mm_or_si128((a), (b))
+#define X128_XOR(a, b)		_mm_xor_si128((a), (b))
+#define X128_XOR3(a, b, c)	X128_XOR(X128_XOR((a), (b)), (c))
+#define X128_MAJ(a, b, c)	X128_OR(X128_AND((a), (b)),		\
+					X128_AND((c), X128_XOR((a), (b))))
+#define X128_ANDN(a, b)		_mm_andnot_si128((a), (b))
+#define X128_MUX(s, a, b)	X128_XOR((a), X128_AND(X128_XOR((a), (b)), (s)))
+#define X128_SHL(a, n)		_mm_slli_epi64((a), (n))
+#define X128_SHR(a, n)		_mm_srli_epi64((a), (n))
+#define X128_CHANGED(d)		(_mm_movemask_epi8(_mm_cmpeq_epi8((d),	\
+					_mm_setzero_si128())) != 0xffff)
+#define X128_CONWAY(s0, s1, s2, s3, m)					\
+	X128_ANDN(s2, X128_AND(s1, X128_OR(s0, m)))
+#define X128_RULE(s0, s1, s2, s3, m)					\
+	LIFE_RULE_NEXT(X128_MUX, s0, s1, s2, s3, m)
+#define X128_ADD(a, b)		_mm_add_epi64((a), (b))
+#define X128_COUNT(next, m)	LIFE_COUNT_CELLS(X128_LOAD, X128_STORE,	\
+						 X128_ADD, X128_XOR,	\
+						 popcount128, next, m)
+
+/**
+ * Count the bits of each word of x, by adding them up in ever wider
+ * fields, down to the bytes, which are added up all at once.
+ */
+__attribute__((target("sse2")))
+static inline __m128i popcount128(__m128i x)
+{
+	const __m128i ones = _mm_set1_epi8(0x55);
+	const __m128i twos = _mm_set1_epi8(0x33);
+	const __m128i fours = _mm_set1_epi8(0x0f);
+
+	x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi64(x, 1), ones));
+	x = _mm_add_epi8(_mm_and_si128(x, twos),
+			 _mm_and_si128(_mm_srli_epi64(x, 2), twos));
+	x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi64(x, 4)), fours);
+
+	return _mm_sad_epu8(x, _mm_setzero_si128());
+}
+
+/**
+ * SSE2 kernel, two words at a time.
+ */
+__attribute__((target("sse2")))
+static void calculateRowSSE2(const uint64_t *above, const uint64_t *row,
+			     const uint64_t *below, uint64_t *out, int words,
+			     unsigned char *changes)
+{
+	int w = 0;
+
+	for (; w + 2 <= words; w += 2) {
+		LIFE_KERNEL_WORDS(__m128i, X128_LOAD, X128_STORE, X128_AND,
+				  X128_OR, X128_XOR, X128_XOR3, X128_MAJ,
+				  X128_ANDN, X128_SHL, X128_SHR, X128_CHANGED,
+				  X128_CONWAY, LIFE_NO_COUNT);
+	}
+
+	calculateRowScalar(above + w, row + w, below + w, out + w, words - w,
+			   changes + w / LIFE_TILE_WORDS);
+}
+
+/**
+ * SSE2 kernel for any rule.
+ */
+__attribute__((target("sse2")))
+static void calculateRuleSSE2(const uint64_t *above, const uint64_t *row,
+			      const uint64_t *below, uint64_t *out, int words,
+			      unsigned char *changes)
+{
+	LIFE_RULE_LEAVES(__m128i, _mm_set1_epi64x);
+	int w = 0;
+
+	for (; w + 2 <= words; w += 2) {
+		LIFE_KERNEL_WORDS(__m128i, X128_LOAD, X128_STORE, X128_AND,
+				  X128_OR, X128_XOR, X128_XOR3, X128_MAJ,
+				  X128_ANDN, X128_SHL, X128_SHR, X128_CHANGED,
+				  X128_RULE, LIFE_NO_COUNT);
+	}
+
+	calculateRuleScalar(above + w, row + w, below + w, out + w, words - w,
+			    changes + w / LIFE_TILE_WORDS);
+}
+
+/**
+ * SSE2 count kernel, two words at a time.
+ */
+__attribute__((target("sse2")))
+static void countRowSSE2(const uint64_t *above, const uint64_t *row,
+			 const uint64_t *below, uint64_t *out, int words,
+			 unsigned char *changes, uint64_t *counts)
+{
+	int w = 0;
+
+	for (; w + 2 <= words; w += 2) {
+		LIFE_KERNEL_WORDS(__m128i, X128_LOAD, X128_STORE, X128_AND,
+				  X128_OR, X128_XOR, X128_XOR3, X128_MAJ,
+				  X128_ANDN, X128_SHL, X128_SHR, X128_CHANGED,
+				  X128_CONWAY, X128_COUNT);
+	}
+
+	countRowScalar(above + w, row + w, below + w, out + w, words - w,
+		       changes + w / LIFE_TILE_WORDS,
+		       counts + w / LIFE_TILE_WORDS * LIFE_COUNT_WORDS);
+}
+
+/**
+ * SSE2 count kernel for any rule.
+ */
+__attribute__((target("sse2")))
+static void countRuleSSE2(const uint64_t *above, const uint64_t *row,
+			  const uint64_t *below, uint64_t *out, int words,
+			  unsigned char *changes, uint64_t *counts)
+{
+	LIFE_RULE_LEAVES(__m128i, _mm_set1_epi64x);
+	int w = 0;
+
+	for (; w + 2 <= words; w += 2) {
+		LIFE_KERNEL_WORDS(__m128i, X128_LOAD, X128_STORE, X128_AND,
+				  X128_OR, X128_XOR, X128_XOR3, X128_MAJ,
+				  X128_ANDN, X128_SHL, X128_SHR, X128_CHANGED,
+				  X128_RULE, X128_COUNT);
+	}
+
+	countRuleScalar(above + w, row + w, below + w, out + w, words - w,
+			changes + w / LIFE_TILE_WORDS,
+			counts + w / LIFE_TILE_WORDS * LIFE_COUNT_WORDS);
+}
+
+#define X256_LOAD(p)		_mm256_loadu_si256((const __m256i *)(p))
+#define X256_STORE(p, v)	_mm256_storeu_si256((__m256i *)(p), (v))
+#define X256_AND(a, b)		_mm256_and_si256((a), (b))
+#define X256_OR(a, b)		_mm256_or_si256((a), (b))
+#define X256_XOR(a, b)		_mm256_xor_si256((a), (b))
+#define X256_XOR3(a, b, c)	X256_XOR(X256_XOR((a), (b)), (c))
+#define X256_MAJ(a, b, c)	X256_OR(X256_AND((a), (b)),		\
+					X256_AND((c), X256_XOR((a), (b))))
+#define X256_ANDN(a, b)		_mm256_andnot_si256((a), (b))
+#define X256_MUX(s, a, b)	X256_XOR((a), X256_AND(X256_XOR((a), (b)), (s)))
+#define X256_SHL(a, n)		_mm256_slli_epi64((a), (n))
+#define X256_SHR(a, n)		_mm256_srli_epi64((a), (n))
+#define X256_CHANGED(d)		(!_mm256_testz_si256((d), (d)))
+#define X256_CONWAY(s0, s1, s2, s3, m)					\
+	X256_ANDN(s2, X256_AND(s1, X256_OR(s0, m)))
+#define X256_RULE(s0, s1, s2, s3, m)					\
+	LIFE_RULE_NEXT(X256_MUX, s0, s1, s2, s3, m)
+#define X256_ADD(a, b)		_mm256_add_epi64((a), (b))
+#define X256_COUNT(next, m)	LIFE_COUNT_CELLS(X256_LOAD, X256_STORE,	\
+						 X256_ADD, X256_XOR,	\
+						 popcount256, next, m)
+
+/**
+ * Count the bits of each word of x, looking up the bits of each half of
+ * every byte in a table, and adding up the bytes all at once.
+ */
+__attribute__((target("avx2")))
+static inline __m256i popcount256(__m256i x)
+{
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+					       1, 2, 2, 3, 2, 3, 3, 4,
+					       0, 1, 1, 2, 1, 2, 2, 3,
+					       1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i counts = _mm256_add_epi8(
+		_mm256_shuffle_epi8(table, _mm256_and_si256(x, low)),
+		_mm256_shuffle_epi8(table,
+			_mm256_and_si256(_mm256_srli_epi64(x, 4), low)));
+
+	return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+/**
+ * AVX2 kernel, four words at a time.
+ */
+__attribute__((target("avx2")))
+static void calculateRowAVX2(const uint64_t *above, const uint64_t *row,
+			     const uint64_t *below, uint64_t *out, int words,
+			     unsigned char *changes)
+{
+	int w = 0;
+
+	for (; w + 4 <= words; w += 4) {
+		LIFE_KERNEL_WORDS(__m256i, X256_LOAD, X256_STORE, X256_AND,
+				  X256_OR, X256_XOR, X256_XOR3, X256_MAJ,
+				  X256_ANDN, X256_SHL, X256_SHR, X256_CHANGED,
+				  X256_CONWAY, LIFE_NO_COUNT);
+	}
+
+	calculateRowScalar(above + w, row + w, below + w, out + w, words - w,
+			   changes + w / LIFE_TILE_WORDS);
+}
+
+/**
+ * AVX2 kernel for any rule.
+ */
+__attribute__((target("avx2")))
+static void calculateRuleAVX2(const uint64_t *above, const uint64_t *row,
+			      const uint64_t *below, uint64_t *out, int words,
+			      unsigned char *changes)
+{
+	LIFE_RULE_LEAVES(__m256i, _mm256_set1_epi64x);
+	int w = 0;
+
+	for (; w + 4 <= words; w += 4) {
+		LIFE_KERNEL_WORDS(__m256i, X256_LOAD, X256_STORE, X256_AND,
+				  X256_OR, X256_XOR, X256_XOR3, X256_MAJ,
+				  X256_ANDN, X256_SHL, X256_SHR, X256_CHANGED,
+				  X256_RULE, LIFE_NO_COUNT);
+	}
+
+	calculateRuleScalar(above + w, row + w, below + w, out + w, words - w,
+			    changes + w / LIFE_TILE_WORDS);
+}
+
+/**
+ * AVX2 count kernel, four words at a time.
+ */
+__attribute__((target("avx2")))
+static void countRowAVX2(const uint64_t *above, const uint64_t *row,
+			 const uint64_t *below, uint64_t *out, int words,
+			 unsigned char *changes, uint64_t *counts)
+{
+	int w = 0;
+
+	for (; w + 4 <= words; w += 4) {
+		LIFE_KERNEL_WORDS(__m256i, X256_LOAD, X256_STORE, X256_AND,
+				  X256_OR, X256_XOR, X256_XOR3, X256_MAJ,
+				  X256_ANDN, X256_SHL, X256_SHR, X256_CHANGED,
+				  X256_CONWAY, X256_COUNT);
+	}
+
+	countRowScalar(above + w, row + w, below + w, out + w, words - w,
+		       changes + w / LIFE_TILE_WORDS,
+		       counts + w / LIFE_TILE_WORDS * LIFE_COUNT_WORDS);
+}
+
+/**
+ * AVX2 count kernel for any rule.
+ */
+__attribute__((target("avx2")))
+static void countRuleAVX2(const uint64_t *above, const uint64_t *row,
+			  const uint64_t *below, uint64_t *out, int words,
+			  unsigned char *changes, uint64_t *counts)
+{
+	LIFE_RULE_LEAVES(__m256i, _mm256_set1_epi64x);
+	int w = 0;
+
+	for (; w + 4 <= words; w += 4) {
+		LIFE_KERNEL_WORDS(__m256i, X256_LOAD, X256_STORE, X256_AND,
+				  X256_OR, X256_XOR, X256_XOR3, X256_MAJ,
+				  X256_ANDN, X256_SHL, X256_SHR, X256_CHANGED,
+				  X256_RULE, X256_COUNT);
+	}
+
+	countRuleScalar(above + w, row + w, below + w, out + w, words - w,
+			changes + w / LIFE_TILE_WORDS,
+			counts + w / LIFE_TILE_WORDS * LIFE_COUNT_WORDS);
+}
+
+/* AVX-512 does any function of three inputs in one instruction. */
+#define X512_LOAD(p)		_mm512_loadu_si512((const void *)(p))
+#define X512_STORE(p, v)	_mm512_storeu_si512((void *)(p), (v))
+#define X512_AND(a, b)		_mm512_and_si512((a), (b))
+#define X512_OR(a, b)		_mm512_or_si512((a), (b))
+#define X512_XOR(a, b)		_mm512_xor_si512((a), (b))
+#define X512_XOR3(a, b, c)	_mm512_ternarylogic_epi64((a), (b), (c), 0x96)
+#define X512_MAJ(a, b, c)	_mm512_ternarylogic_epi64((a), (b), (c), 0xe8)
+#define X512_ANDN(a, b)		_mm512_andnot_si512((a), (b))
+#define X512_MUX(s, a, b)	_mm512_ternarylogic_epi64((s), (b), (a), 0xca)
+#define X512_SHL(a, n)		_mm512_slli_epi64((a), (n))
+#define X512_SHR(a, n)		_mm512_srli_epi64((a), (n))
+#define X512_CHANGED(d)		(_mm512_test_epi64_mask((d), (d)) != 0)
+#define X512_CONWAY(s0, s1, s2, s3, m)					\
+	X512_ANDN(s2, X512_AND(s1, X512_OR(s0, m)))
+#define X512_RULE(s0, s1, s2, s3, m)					\
+	LIFE_RULE_NEXT(X512_MUX, s0, s1, s2, s3, m)
+#define X512_ADD(a, b)		_mm512_add_epi64((a), (b))
+#define X512_COUNT(next, m)	LIFE_COUNT_CELLS(X512_LOAD, X512_STORE,	\
+						 X512_ADD, X512_XOR,	\
+						 _mm512_popcnt_epi64, next, m)
+
+/**
+ * AVX-512 kernel, eight words at a time.
+ */
+__attribute__((target("avx512f")))
+static void calculateRowAVX512(const uint64_t *above, const uint64_t *row,
+			       const uint64_t *below, uint64_t *out, int words,
+			       unsigned char *changes)
+{
+	int w = 0;
+
+	for (; w + 8 <= words; w += 8) {
+		LIFE_KERNEL_WORDS(__m512i, X512_LOAD, X512_STORE, X512_AND,
+				  X512_OR, X512_XOR, X512_XOR3, X512_MAJ,
+				  X512_ANDN, X512_SHL, X512_SHR, X512_CHANGED,
+				  X512_CONWAY, LIFE_NO_COUNT);
+	}
+
+	calculateRowScalar(above + w, row + w, below + w, out + w, words - w,
+			   changes + w / LIFE_TILE_WORDS);
+}
+
+/**
+ * AVX-512 kernel for any rule.
+ */
+__attribute__((target("avx512f")))
+static void calculateRuleAVX512(const uint64_t *above, const uint64_t *row,
+				const uint64_t *below, uint64_t *out, int words,
+				unsigned char *changes)
+{
+	LIFE_RULE_LEAVES(__m512i, _mm512_set1_epi64);
+	int w = 0;
+
+	for (; w + 8 <= words; w += 8) {
+		LIFE_KERNEL_WORDS(__m512i, X512_LOAD, X512_STORE, X512_AND,
+				  X512_OR, X512_XOR, X512_XOR3, X512_MAJ,
+				  X512_ANDN, X512_SHL, X512_SHR, X512_CHANGED,
+				  X512_RULE, LIFE_NO_COUNT);
+	}
+
+	calculateRuleScalar(above + w, row + w, below + w, out + w, words - w,
+			    changes + w / LIFE_TILE_WORDS);
+}
+
+/**
+ * AVX-512 count kernel, eight words at a time, for the CPUs that count
+ * bits in vectors.
+ */
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static void countRowAVX512(const uint64_t *above, const uint64_t *row,
+			   const uint64_t *below, uint64_t *out, int words,
+			   unsigned char *changes, uint64_t *counts)
+{
+	int w = 0;
+
+	for (; w + 8 <= words; w += 8) {
+		LIFE_KERNEL_WORDS(__m512i, X512_LOAD, X512_STORE, X512_AND,
+				  X512_OR, X512_XOR, X512_XOR3, X512_MAJ,
+				  X512_ANDN, X512_SHL, X512_SHR, X512_CHANGED,
+				  X512_CONWAY, X512_COUNT);
+	}
+
+	countRowScalar(above + w, row + w, below + w, out + w, words - w,
+		       changes + w / LIFE_TILE_WORDS,
+		       counts + w / LIFE_TILE_WORDS * LIFE_COUNT_WORDS);
+}
+
+/**
+ * AVX-512 count kernel for any rule.
+ */
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static void countRuleAVX512(const uint64_t *above, const uint64_t *row,
+			    const uint64_t *below, uint64_t *out, int words,
+			    unsigned char *changes, uint64_t *counts)
+{
+	LIFE_RULE_LEAVES(__m512i, _mm512_set1_epi64);
+	int w = 0;
+
+	for (; w + 8 <= words; w += 8) {
+		LIFE_KERNEL_WORDS(__m512i, X512_LOAD, X512_STORE, X512_AND,
+				  X512_OR, X512_XOR, X512_XOR3, X512_MAJ,
+				  X512_ANDN, X512_SHL, X512_SHR, X512_CHANGED,
+				  X512_RULE, X512_COUNT);
+	}
+
+	countRuleScalar(above + w, row + w, below + w, out + w, words - w,
+			changes + w / LIFE_TILE_WORDS,
+			counts + w / LIFE_TILE_WORDS * LIFE_COUNT_WORDS);
+}
+
+static int hasSSE2(void)   { return __builtin_cpu_supports("sse2"); }
+static int hasAVX2(void)   { return __builtin_cpu_supports("avx2"); }
+static int hasAVX512(void) { return __builtin_cpu_supports("avx512f"); }
+static int hasVPOPCNTDQ(void)
+{
+	return __builtin_cpu_supports("avx512vpopcntdq");
+}
+
+#endif
+
+typedef struct LifeKernel
+{
+	const char *name;
+	LifeRowKernel row;
+	LifeRowKernel rule;
+	LifeCountKernel countRow;
+	LifeCountKernel countRule;
+	int (*supported)(void);
+} LifeKernel;
+
+/* In order of preference. */
+static const LifeKernel kernels[] = {
+#ifdef LIFE_KERNEL_X86
+	{ "avx512", &calculateRowAVX512, &calculateRuleAVX512,
+	  &countRowAVX512, &countRuleAVX512, &hasAVX512 },
+	{ "avx2",   &calculateRowAVX2,   &calculateRuleAVX2,
+	  &countRowAVX2,   &countRuleAVX2,   &hasAVX2 },
+	{ "sse2",   &calculateRowSSE2,   &calculateRuleSSE2,
+	  &countRowSSE2,   &countRuleSSE2,   &hasSSE2 },
+#endif
+	{ "scalar", &calculateRowScalar, &calculateRuleScalar,
+	  &countRowScalar, &countRuleScalar, NULL },
+};
+
+#define KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+LifeRowKernel lifeRowKernel = &calculateRowScalar;
+LifeCountKernel lifeCountKernel = &countRowScalar;
+LifeRule lifeRule = { LIFE_CONWAY_BIRTH, LIFE_CONWAY_SURVIVAL };
+static const LifeKernel *lifeKernel = &kernels[KERNELS - 1];
+
+/**
+ * Point lifeRowKernel and lifeCountKernel at the Conway kernels for
+ * Conway's rule, which need no lookup table, and at the ones for any rule
+ * otherwise. Not every CPU with AVX-512 counts bits in vectors, and those
+ * that do not count with AVX2 instead.
+ */
+static void updateRowKernel(void)
+{
+	boolean conway = lifeRule.birth == LIFE_CONWAY_BIRTH &&
+		lifeRule.survival == LIFE_CONWAY_SURVIVAL;
+	const LifeKernel *counter = lifeKernel;
+
+#ifdef LIFE_KERNEL_X86
+	if (counter->countRow == &countRowAVX512 && !hasVPOPCNTDQ()) {
+		counter++;
+	}
+#endif
+
+	lifeRowKernel = conway ? lifeKernel->row : lifeKernel->rule;
+	lifeCountKernel = conway ? counter->countRow : counter->countRule;
+}
+
+/**
+ * Select the row kernel to use from now on, by name, or the fastest one
+ * the CPU supports if the name is NULL.
+ *
+ * @Return false if there is no such kernel or the CPU does not support it
+ */
+boolean selectLifeKernel(const char *name)
+{
+	for (int i = 0; i < KERNELS; i++) {
+		if (name != NULL && strcmp(name, kernels[i].name) != 0) {
+			continue;
+		}
+		if (kernels[i].supported != NULL && !kernels[i].supported()) {
+			continue;
+		}
+
+		lifeKernel = &kernels[i];
+		updateRowKernel();
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @Return the name of the row kernel in use
+ */
+const char *getLifeKernel(void)
+{
+	return lifeKernel->name;
+}
+
+/**
+ * @Return the name of kernel i, or NULL past the last one
+ */
+const char *getLifeKernelName(int i)
+{
+	return i >= 0 && i < KERNELS ? kernels[i].name : NULL;
+}
+
+/**
+ * Read the neighbour counts of one half of a rulestring into a mask.
+ *
+ * @Return the first character after the counts
+ */
+static const char *parseCounts(const char *counts, uint16_t *mask)
+{
+	*mask = 0;
+	while (*counts >= '0' && *counts <= '8') {
+		*mask |= (uint16_t)(1 << (*counts - '0'));
+		counts++;
+	}
+
+	return counts;
+}
+
+/**
+ * Read a rulestring, either as B3/S23 with the halves in any order, or
+ * in the older form 23/3 with survival first.
+ *
+ * @Return false if the rulestring is not valid
+ */
+boolean parseLifeRule(const char *rulestring, LifeRule *rule)
+{
+	const char *p = rulestring;
+	uint16_t first = 0;
+	uint16_t second = 0;
+	char firstName = 0;
+	char secondName = 0;
+
+	if (rulestring == NULL || rule == NULL) {
+		return false;
+	}
+
+	if (*p == 'B' || *p == 'b' || *p == 'S' || *p == 's') {
+		firstName = (char)(*p++ | 0x20);
+	}
+	p = parseCounts(p, &first);
+	if (*p++ != '/') {
+		return false;
+	}
+	if (*p == 'B' || *p == 'b' || *p == 'S' || *p == 's') {
+		secondName = (char)(*p++ | 0x20);
+	}
+	p = parseCounts(p, &second);
+	if (*p != '\0') {
+		return false;
+	}
+
+	if (firstName == 0 && secondName == 0) {
+		rule->survival = first;
+		rule->birth = second;
+	} else if (firstName == 'b' && secondName == 's') {
+		rule->birth = first;
+		rule->survival = second;
+	} else if (firstName == 's' && secondName == 'b') {
+		rule->survival = first;
+		rule->birth = second;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Use the rule from now on, in every kernel. Boards that are part way
+ * through a run have to be marked as changed afterwards.
+ */
+void setLifeRule(const LifeRule *rule)
+{
+	lifeRule = *rule;
+
+	for (int c = 0; c < 9; c++) {
+		ruleLeaves[0][c] = (rule->birth >> c) & 1 ? ~(uint64_t)0 : 0;
+		ruleLeaves[1][c] = (rule->survival >> c) & 1 ? ~(uint64_t)0 : 0;
+	}
+
+	updateRowKernel();
+}
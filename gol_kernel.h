@@ -0,0 +1,93 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_KERNEL_H_
+#define __GOL_KERNEL_H_
+
+#include <stdint.h>
+
+#include "gol_backend.h"
+
+/*
+ * A row kernel calculates the next generation of a run of words in a row,
+ * given the same words of the rows above and below. It reads one word to
+ * either side of the run, but only ever writes inside it.
+ *
+ * The run starts on a tile boundary, and for every tile where the new words
+ * differ from the ones they overwrite, the flag for that tile is set.
+ */
+typedef void (*LifeRowKernel)(const uint64_t *, const uint64_t *,
+			      const uint64_t *, uint64_t *, int,
+			      unsigned char *);
+
+/*
+ * A count kernel is a row kernel that also counts the new words into the
+ * counts of their tiles, LIFE_COUNT_WORDS words a tile: the live cells in
+ * the first LIFE_TILE_WORDS, a count for each word of the tile, and the
+ * cells that differ from those of the row itself in the ones after.
+ */
+typedef void (*LifeCountKernel)(const uint64_t *, const uint64_t *,
+				const uint64_t *, uint64_t *, int,
+				unsigned char *, uint64_t *);
+
+#define LIFE_COUNT_WORDS (2 * LIFE_TILE_WORDS)
+
+/*
+ * A rule for which counts of live neighbours a dead cell is born with and
+ * a live cell survives with, as masks with bit n set for a count of n.
+ */
+typedef struct LifeRule
+{
+	uint16_t birth;
+	uint16_t survival;
+} LifeRule;
+
+#define LIFE_CONWAY_BIRTH    (1 << 3)
+#define LIFE_CONWAY_SURVIVAL ((1 << 2) | (1 << 3))
+
+/*
+ * The new cells for the rule in use, from the bit planes s0 to s3 of the
+ * count of live neighbours and the cells m themselves, looked up in
+ * leaf[m][count], where every entry is all ones or all zeros. The count is
+ * taken apart one bit plane at a time with selects; a count of eight is
+ * the only one with s3 set, and has the other planes cleared.
+ */
+#define LIFE_RULE_COUNT(MUX, L, s0, s1, s2, s3)				\
+	MUX(s3, MUX(s2, MUX(s1, MUX(s0, L[0], L[1]), MUX(s0, L[2], L[3])),	\
+		    MUX(s1, MUX(s0, L[4], L[5]), MUX(s0, L[6], L[7]))),	\
+	    L[8])
+#define LIFE_RULE_NEXT(MUX, s0, s1, s2, s3, m)				\
+	MUX(m, LIFE_RULE_COUNT(MUX, leaf[0], s0, s1, s2, s3),		\
+	    LIFE_RULE_COUNT(MUX, leaf[1], s0, s1, s2, s3))
+
+extern LifeRowKernel lifeRowKernel;
+extern LifeCountKernel lifeCountKernel;
+extern LifeRule lifeRule;
+
+boolean selectLifeKernel(const char *);
+const char *getLifeKernel(void);
+const char *getLifeKernelName(int);
+
+boolean parseLifeRule(const char *, LifeRule *);
+void setLifeRule(const LifeRule *);
+
+#endif
@@ -0,0 +1,355 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_pattern.h"
+
+/* Bytes read from the file at a time, all the memory a load needs. */
+#define PATTERN_BUFFER 65536
+
+/* Longest header line looked at, the rest of it is skipped. */
+#define PATTERN_LINE 256
+
+/* Run counts are capped well past any board so they cannot overflow. */
+#define PATTERN_MAX_RUN (1L << 40)
+
+typedef struct PatternReader
+{
+	FILE *file;
+	size_t position;
+	size_t length;
+	unsigned char buffer[PATTERN_BUFFER];
+} PatternReader;
+
+/**
+ * Get the next byte of the file, or EOF.
+ */
+static int readByte(PatternReader *reader)
+{
+	if (reader->position == reader->length) {
+		reader->length = fread(reader->buffer, 1, PATTERN_BUFFER,
+				       reader->file);
+		reader->position = 0;
+		if (reader->length == 0) {
+			return EOF;
+		}
+	}
+
+	return reader->buffer[reader->position++];
+}
+
+/**
+ * Put back the byte just read.
+ */
+static void unreadByte(PatternReader *reader)
+{
+	reader->position--;
+}
+
+/**
+ * Read the rest of a line into line, cut short at size bytes.
+ *
+ * @Return false at the end of the file
+ */
+static boolean readLine(PatternReader *reader, char *line, size_t size)
+{
+	size_t length = 0;
+	int c = readByte(reader);
+
+	if (c == EOF) {
+		return false;
+	}
+	while (c != EOF && c != '\n') {
+		if (length + 1 < size && c != '\r') {
+			line[length++] = (char)c;
+		}
+		c = readByte(reader);
+	}
+	line[length] = '\0';
+
+	return true;
+}
+
+/**
+ * Set length cells of row y from x on, leaving out those off the board,
+ * a word at a time.
+ */
+static void setRun(LifeBoard *board, long x, long y, long length)
+{
+	long end = x + length;
+
+	if (y < 0 || y >= board->boardSize || x >= board->boardSize ||
+	    end <= 0) {
+		return;
+	}
+	if (x < 0) {
+		x = 0;
+	}
+	if (end > board->boardSize) {
+		end = board->boardSize;
+	}
+
+	uint64_t *row = lifeRow(board, (int)y);
+	long first = x / 64;
+	long last = (end - 1) / 64;
+	uint64_t head = ~(uint64_t)0 << (x % 64);
+	uint64_t tail = ~(uint64_t)0 >> (63 - (end - 1) % 64);
+
+	if (first == last) {
+		row[first] |= head & tail;
+		return;
+	}
+	row[first] |= head;
+	for (long w = first + 1; w < last; w++) {
+		row[w] = ~(uint64_t)0;
+	}
+	row[last] |= tail;
+}
+
+/**
+ * Read the cells of an RLE pattern, the header line already read.
+ */
+static boolean readRunLengths(PatternReader *reader, LifeBoard *board,
+			      long x, long y)
+{
+	long column = 0;
+	long count = 0;
+	int c;
+
+	while ((c = readByte(reader)) != EOF && c != '!') {
+		if (isdigit(c)) {
+			if (count < PATTERN_MAX_RUN) {
+				count = count * 10 + (c - '0');
+			}
+			continue;
+		}
+		if (count == 0) {
+			count = 1;
+		}
+
+		if (c == '$') {
+			y += count;
+			column = 0;
+		} else if (c == 'b' || c == '.') {
+			column += count;
+		} else if (isalpha(c)) {
+			// every other state of a multistate pattern is alive.
+			setRun(board, x + column, y, count);
+			column += count;
+		} else if (c == '#') {
+			char line[PATTERN_LINE];
+			(void)readLine(reader, line, sizeof(line));
+		} else if (!isspace(c)) {
+			return false;
+		}
+		count = 0;
+	}
+
+	return true;
+}
+
+/**
+ * Read the cells of a Life 1.06 pattern, one pair of coordinates a line.
+ */
+static boolean readCoordinates(PatternReader *reader, LifeBoard *board,
+			       long x, long y)
+{
+	char line[PATTERN_LINE];
+
+	while (readLine(reader, line, sizeof(line))) {
+		long column;
+		long row;
+
+		if (line[0] == '#' || line[strspn(line, " \t")] == '\0') {
+			continue;
+		}
+		if (sscanf(line, "%ld %ld", &column, &row) != 2) {
+			return false;
+		}
+		setRun(board, x + column, y + row, 1);
+	}
+
+	return true;
+}
+
+/**
+ * Read the cells of a plaintext pattern, a dot for a dead cell and an O
+ * for a live one, each line a row and ! starting a comment.
+ */
+static boolean readPlaintext(PatternReader *reader, LifeBoard *board,
+			     long x, long y)
+{
+	boolean comment = false;
+	long column = 0;
+	long start = -1;
+	int c;
+
+	do {
+		c = readByte(reader);
+		boolean alive = !comment && (c == 'O' || c == '*');
+
+		if (start >= 0 && !alive) {
+			setRun(board, x + start, y, column - start);
+			start = -1;
+		}
+
+		if (c == EOF || c == '\n') {
+			if (!comment) {
+				y++;
+			}
+			comment = false;
+			column = 0;
+		} else if (comment || c == '\r') {
+			continue;
+		} else if (column == 0 && c == '!') {
+			comment = true;
+		} else if (alive) {
+			if (start < 0) {
+				start = column;
+			}
+			column++;
+		} else if (c == '.') {
+			column++;
+		} else if (!isspace(c)) {
+			return false;
+		}
+	} while (c != EOF);
+
+	return true;
+}
+
+/**
+ * Find the value of key in an RLE header line, as in x = 3, rule = B3/S23.
+ *
+ * @Return a pointer to the value, or NULL
+ */
+static char *findHeaderValue(char *line, const char *key)
+{
+	for (char *field = line; field != NULL; field = strchr(field, ',')) {
+		field += strspn(field, ", \t");
+		size_t length = strlen(key);
+		if (strncmp(field, key, length) != 0) {
+			continue;
+		}
+		field += length;
+		field += strspn(field, " \t");
+		if (*field != '=') {
+			continue;
+		}
+		field++;
+
+		return field + strspn(field, " \t");
+	}
+
+	return NULL;
+}
+
+/**
+ * Load a pattern in the RLE, Life 1.06 or plaintext format from path into
+ * the board with its top left corner at (x, y), streaming it through a
+ * small buffer and setting runs of cells a word at a time. Cells that end
+ * up off the board are left out, and cells already on the board stay.
+ * If the pattern names a rule it is parsed into rule and hasRule set; a
+ * topology after the rule, as in B3/S23:T64,64, is left out, and a rule
+ * that does not parse is warned about and left out as well.
+ *
+ * @Return false if the file could not be read or is not a pattern
+ */
+boolean loadPattern(LifeBoard *board, const char *path, long x, long y,
+		    LifeRule *rule, boolean *hasRule)
+{
+	char line[PATTERN_LINE];
+	boolean ok = false;
+
+	if (hasRule != NULL) {
+		*hasRule = false;
+	}
+
+	PatternReader *reader = (PatternReader *)malloc(sizeof(PatternReader));
+	if (reader == NULL) {
+		return false;
+	}
+	reader->file = fopen(path, "r");
+	if (reader->file == NULL) {
+		free(reader);
+		return false;
+	}
+	reader->position = 0;
+	reader->length = 0;
+
+	// the first line that is not a comment tells the formats apart.
+	int c;
+	while ((c = readByte(reader)) != EOF) {
+		if (c == '!' || c == '.' || c == 'O' || c == '*') {
+			unreadByte(reader);
+			ok = readPlaintext(reader, board, x, y);
+			break;
+		}
+		if (isspace(c)) {
+			continue;
+		}
+
+		unreadByte(reader);
+		if (!readLine(reader, line, sizeof(line))) {
+			break;
+		}
+		if (strncmp(line, "#Life 1.06", 10) == 0) {
+			ok = readCoordinates(reader, board, x, y);
+			break;
+		}
+		if (line[0] == '#') {
+			continue;
+		}
+
+		char *value = findHeaderValue(line, "rule");
+		if (findHeaderValue(line, "x") == NULL) {
+			break;
+		}
+		if (value != NULL && rule != NULL) {
+			value[strcspn(value, ":, \t")] = '\0';
+			if (parseLifeRule(value, rule)) {
+				if (hasRule != NULL) {
+					*hasRule = true;
+				}
+			} else {
+				fprintf(stderr, "Rule %s in %s is not a valid "
+					"rulestring, ignoring it.\n", value,
+					path);
+			}
+		}
+		ok = readRunLengths(reader, board, x, y);
+		break;
+	}
+
+	if (ferror(reader->file)) {
+		ok = false;
+	}
+	(void)fclose(reader->file);
+	free(reader);
+	markBoardChanged(board);
+
+	return ok;
+}
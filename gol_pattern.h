@@ -20,24 +20,13 @@
  * THE SOFTWARE
  */
 
-#ifndef __LIST_H_
-#define __LIST_H_
+#ifndef __GOL_PATTERN_H_
+#define __GOL_PATTERN_H_
 
-typedef struct Node
-{
-	void *value;
-	struct Node *next;
-} Node;
+#include "gol_backend.h"
+#include "gol_kernel.h"
 
-typedef struct CircularList
-{
-	unsigned int size;
-	unsigned int next;
-	struct Node *nodes;
-} CircularList;
-
-CircularList *createCircularList(unsigned int);
-void destroyCircularList(CircularList *);
-void addToCircularList(CircularList *, void *);
+boolean loadPattern(LifeBoard *, const char *, long, long, LifeRule *,
+		    boolean *);
 
 #endif
@@ -0,0 +1,176 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_period.h"
+
+/**
+ * Find the slot of hash in the table, or the empty slot where it would go.
+ */
+static size_t findSlot(LifePeriod *period, uint64_t hash)
+{
+	size_t slot = (size_t)hash & period->mask;
+
+	while (period->table[slot].used && period->table[slot].hash != hash) {
+		slot = (slot + 1) & period->mask;
+	}
+
+	return slot;
+}
+
+/**
+ * Empty a slot, moving the entries after it that would no longer be found
+ * back into it.
+ */
+static void removeSlot(LifePeriod *period, size_t slot)
+{
+	size_t next = slot;
+
+	for (;;) {
+		next = (next + 1) & period->mask;
+		if (!period->table[next].used) {
+			break;
+		}
+
+		// entries whose home lies cyclically in (slot, next] stay.
+		size_t home = (size_t)period->table[next].hash & period->mask;
+		if (((next - home) & period->mask) >=
+		    ((next - slot) & period->mask)) {
+			period->table[slot] = period->table[next];
+			slot = next;
+		}
+	}
+
+	period->table[slot].used = false;
+}
+
+/**
+ * Create a detector remembering the last window generations.
+ *
+ * @Return the detector, or NULL if out of memory
+ */
+LifePeriod *createPeriodDetector(unsigned long long window)
+{
+	if (window == 0) {
+		return NULL;
+	}
+
+	LifePeriod *period = (LifePeriod *)calloc(1, sizeof(LifePeriod));
+	if (period == NULL) {
+		return NULL;
+	}
+
+	// keep the table at most half full.
+	size_t size = 16;
+	while (size < 2 * window) {
+		size *= 2;
+	}
+
+	period->table = (LifePeriodEntry *)calloc(size, sizeof(LifePeriodEntry));
+	period->ring = (uint64_t *)malloc(sizeof(uint64_t) * window);
+	if (period->table == NULL || period->ring == NULL) {
+		destroyPeriodDetector(period);
+		return NULL;
+	}
+	period->mask = size - 1;
+	period->window = window;
+
+	return period;
+}
+
+/**
+ * Free a detector.
+ */
+void destroyPeriodDetector(LifePeriod *period)
+{
+	if (period == NULL) {
+		return;
+	}
+
+	free(period->table);
+	free(period->ring);
+	free(period);
+}
+
+/**
+ * Forget the generations seen, for when the board was changed by hand or
+ * went back in time.
+ */
+void resetPeriodDetector(LifePeriod *period)
+{
+	if (period == NULL) {
+		return;
+	}
+
+	(void)memset(period->table, 0x0,
+		     sizeof(LifePeriodEntry) * (period->mask + 1));
+	period->count = 0;
+	period->period = 0;
+}
+
+/**
+ * Remember the hash of a generation, which has to follow the one before.
+ * If it is the same as that of one of the last window generations, start
+ * is set to that generation and period to how far back it is.
+ *
+ * @Return true if the board has repeated itself
+ */
+boolean detectPeriod(LifePeriod *period, uint64_t hash,
+		     unsigned long long generation)
+{
+	if (period == NULL) {
+		return false;
+	}
+
+	// only look back over generations that followed one another.
+	if (period->count > 0 && generation != period->last + 1) {
+		resetPeriodDetector(period);
+	}
+
+	// forget the generation that falls out of the window.
+	if (period->count >= period->window) {
+		uint64_t old = period->ring[generation % period->window];
+		size_t slot = findSlot(period, old);
+		if (period->table[slot].used &&
+		    period->table[slot].generation == generation - period->window) {
+			removeSlot(period, slot);
+		}
+	}
+
+	size_t slot = findSlot(period, hash);
+	boolean repeated = period->table[slot].used;
+	if (repeated) {
+		period->start = period->table[slot].generation;
+		period->period = generation - period->start;
+	}
+
+	period->table[slot].hash = hash;
+	period->table[slot].generation = generation;
+	period->table[slot].used = true;
+	period->ring[generation % period->window] = hash;
+	period->last = generation;
+	period->count++;
+
+	return repeated;
+}
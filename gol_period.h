@@ -0,0 +1,61 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_PERIOD_H_
+#define __GOL_PERIOD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gol_backend.h"
+
+typedef struct LifePeriodEntry
+{
+	uint64_t hash;
+	unsigned long long generation;
+	boolean used;
+} LifePeriodEntry;
+
+/*
+ * The hashes of the last window generations, in a ring in the order they
+ * came and in an open addressed table to look them up by. A generation
+ * with the same hash as one of them starts the board over, so from the
+ * one it repeats on the board goes round with a period of the difference.
+ */
+typedef struct LifePeriod
+{
+	LifePeriodEntry *table;
+	size_t mask;
+	uint64_t *ring;
+	unsigned long long window;
+	unsigned long long count;
+	unsigned long long last;
+	unsigned long long start;
+	unsigned long long period;
+} LifePeriod;
+
+LifePeriod *createPeriodDetector(unsigned long long);
+void destroyPeriodDetector(LifePeriod *);
+void resetPeriodDetector(LifePeriod *);
+boolean detectPeriod(LifePeriod *, uint64_t, unsigned long long);
+
+#endif
@@ -0,0 +1,188 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "gol_profile.h"
+
+/* Bits of a time below its highest one that pick its bucket. */
+#define STEP_BITS __builtin_ctz(LIFE_PROFILE_STEPS)
+
+static const char *phaseNames[LIFE_PHASES] = {
+	"poll", "step", "history", "render", "swap"
+};
+
+/**
+ * Create a profile with nothing timed yet.
+ *
+ * @Return the profile, or NULL if out of memory
+ */
+LifeProfile *createProfile(void)
+{
+	return (LifeProfile *)calloc(1, sizeof(LifeProfile));
+}
+
+/**
+ *
+ *
+ */
+void destroyProfile(LifeProfile *profile)
+{
+	free(profile);
+}
+
+/**
+ * @Return the time now in nanoseconds, from a clock that never goes back
+ */
+uint64_t startTimer(void)
+{
+	struct timespec now;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @Return the bucket for a time of nanoseconds
+ */
+static int findBucket(uint64_t nanoseconds)
+{
+	if (nanoseconds < LIFE_PROFILE_STEPS) {
+		return (int)nanoseconds;
+	}
+
+	int octave = 63 - __builtin_clzll(nanoseconds);
+	int step = (int)(nanoseconds >> (octave - STEP_BITS)) &
+		(LIFE_PROFILE_STEPS - 1);
+
+	return (octave - STEP_BITS + 1) * LIFE_PROFILE_STEPS + step;
+}
+
+/**
+ * @Return the longest time that goes in bucket
+ */
+static uint64_t bucketTop(int bucket)
+{
+	if (bucket < LIFE_PROFILE_STEPS) {
+		return (uint64_t)bucket;
+	}
+
+	int shift = bucket / LIFE_PROFILE_STEPS - 1;
+	uint64_t step = (uint64_t)(bucket % LIFE_PROFILE_STEPS);
+
+	return ((LIFE_PROFILE_STEPS + step + 1) << shift) - 1;
+}
+
+/**
+ * Add a word the caller is the only one to write to, so that readers on
+ * other threads see either the old or the new value.
+ */
+static inline void addCount(uint64_t *count, uint64_t value)
+{
+	__atomic_store_n(count, __atomic_load_n(count, __ATOMIC_RELAXED) +
+			 value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Add the time since start, as returned by startTimer, to the histogram
+ * of phase. Does nothing without a profile.
+ */
+void stopTimer(LifeProfile *profile, LifePhase phase, uint64_t start)
+{
+	if (profile == NULL) {
+		return;
+	}
+
+	uint64_t nanoseconds = startTimer() - start;
+	LifeHistogram *histogram = &profile->phases[phase];
+
+	addCount(&histogram->buckets[findBucket(nanoseconds)], 1);
+	addCount(&histogram->count, 1);
+	addCount(&histogram->total, nanoseconds);
+	if (nanoseconds > histogram->max) {
+		__atomic_store_n(&histogram->max, nanoseconds,
+				 __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * @Return the time that a fraction of the times in histogram, out of
+ * count, are no longer than, give or take the width of its bucket
+ */
+static uint64_t findPercentile(const LifeHistogram *histogram,
+			       uint64_t count, double fraction)
+{
+	uint64_t rank = (uint64_t)(fraction * (double)count + 0.5);
+	uint64_t seen = 0;
+
+	if (rank == 0) {
+		rank = 1;
+	}
+
+	for (int bucket = 0; bucket < LIFE_PROFILE_BUCKETS; bucket++) {
+		seen += __atomic_load_n(&histogram->buckets[bucket],
+					__ATOMIC_RELAXED);
+		if (seen >= rank) {
+			uint64_t top = bucketTop(bucket);
+			uint64_t max = __atomic_load_n(&histogram->max,
+						       __ATOMIC_RELAXED);
+			return top < max ? top : max;
+		}
+	}
+
+	return __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+}
+
+/**
+ * Print the median, 99th percentile, longest and mean time of every phase
+ * that was timed, in microseconds.
+ */
+void printProfile(FILE *file, const LifeProfile *profile)
+{
+	if (file == NULL || profile == NULL) {
+		return;
+	}
+
+	fprintf(file, "%-8s %10s %10s %10s %10s %10s\n", "phase", "count",
+		"p50 us", "p99 us", "max us", "mean us");
+	for (int phase = 0; phase < LIFE_PHASES; phase++) {
+		const LifeHistogram *histogram = &profile->phases[phase];
+		uint64_t count = __atomic_load_n(&histogram->count,
+						 __ATOMIC_RELAXED);
+		if (count == 0) {
+			continue;
+		}
+
+		uint64_t total = __atomic_load_n(&histogram->total,
+						 __ATOMIC_RELAXED);
+		uint64_t max = __atomic_load_n(&histogram->max,
+					       __ATOMIC_RELAXED);
+		fprintf(file, "%-8s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+			phaseNames[phase], (unsigned long long)count,
+			findPercentile(histogram, count, 0.50) / 1e3,
+			findPercentile(histogram, count, 0.99) / 1e3,
+			max / 1e3, (double)total / (double)count / 1e3);
+	}
+	(void)fflush(file);
+}
@@ -0,0 +1,76 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_PROFILE_H_
+#define __GOL_PROFILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* The parts of a frame and a generation that are timed. */
+typedef enum LifePhase
+{
+	LIFE_PHASE_POLL = 0,
+	LIFE_PHASE_STEP,
+	LIFE_PHASE_HISTORY,
+	LIFE_PHASE_RENDER,
+	LIFE_PHASE_SWAP,
+	LIFE_PHASES
+} LifePhase;
+
+/*
+ * Buckets per power of two of nanoseconds, a power of two itself. Times
+ * below that many nanoseconds have a bucket each.
+ */
+#define LIFE_PROFILE_STEPS   8
+#define LIFE_PROFILE_BUCKETS ((64 - 2) * LIFE_PROFILE_STEPS)
+
+/*
+ * How long a phase took, counted in buckets that are at most an eighth of
+ * the times in them wide, so that the percentiles read from them are off
+ * by no more than that.
+ */
+typedef struct LifeHistogram
+{
+	uint64_t buckets[LIFE_PROFILE_BUCKETS];
+	uint64_t count;
+	uint64_t total;
+	uint64_t max;
+} LifeHistogram;
+
+/*
+ * A histogram for each phase. Every phase is only ever timed on one
+ * thread, so the counts are added to without locking, and only read
+ * whole words at a time by whoever prints them.
+ */
+typedef struct LifeProfile
+{
+	LifeHistogram phases[LIFE_PHASES];
+} LifeProfile;
+
+LifeProfile *createProfile(void);
+void destroyProfile(LifeProfile *);
+uint64_t startTimer(void);
+void stopTimer(LifeProfile *, LifePhase, uint64_t);
+void printProfile(FILE *, const LifeProfile *);
+
+#endif
@@ -0,0 +1,399 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gol_hashlife.h"
+#include "gol_simulation.h"
+
+// how long to wait between looks at the commands while paused.
+#define PAUSE_SLEEP 0.001
+
+/**
+ * Sleep for the given number of seconds.
+ */
+static void sleepSeconds(double seconds)
+{
+	struct timespec time;
+
+	if (seconds <= 0.0) {
+		return;
+	}
+
+	time.tv_sec = (time_t)seconds;
+	time.tv_nsec = (long)((seconds - (double)time.tv_sec) * 1e9);
+	(void)nanosleep(&time, NULL);
+}
+
+/**
+ * Create a simulation of a board, or of a sparse board shown through it,
+ * starting from the given generation. It does not run until started.
+ *
+ * @Return the simulation, or NULL if out of memory
+ */
+LifeSimulation *createSimulation(LifeBoard *board, SparseBoard *sparse,
+				 unsigned long long generation)
+{
+	if (board == NULL) {
+		return NULL;
+	}
+
+	LifeSimulation *simulation =
+		(LifeSimulation *)calloc(1, sizeof(LifeSimulation));
+	if (simulation == NULL) {
+		return NULL;
+	}
+
+	simulation->board = board;
+	simulation->sparse = sparse;
+	simulation->generation = generation;
+	simulation->topology = LIFE_TORUS;
+	simulation->back = 0;
+	simulation->middle = 1;
+	simulation->front = 2;
+	for (int i = 0; i < 3; i++) {
+		simulation->frames[i] = createLifeBoard(board->boardSize);
+		if (simulation->frames[i] == NULL) {
+			destroySimulation(simulation);
+			return NULL;
+		}
+	}
+
+	return simulation;
+}
+
+/**
+ * Stop the simulation if it is running, and free it. The boards and the
+ * history are not its to free.
+ */
+void destroySimulation(LifeSimulation *simulation)
+{
+	if (simulation == NULL) {
+		return;
+	}
+
+	stopSimulation(simulation);
+	for (int i = 0; i < 3; i++) {
+		destroyLifeBoard(simulation->frames[i]);
+	}
+	free(simulation);
+}
+
+/**
+ * Queue a command for the simulation.
+ *
+ * @Return false if the queue is full
+ */
+boolean sendCommand(LifeSimulation *simulation, const LifeCommand *command)
+{
+	if (simulation == NULL) {
+		return false;
+	}
+
+	unsigned int tail = simulation->tail;
+	unsigned int head = __atomic_load_n(&simulation->head,
+					    __ATOMIC_ACQUIRE);
+	if (tail - head == LIFE_COMMANDS) {
+		return false;
+	}
+
+	simulation->commands[tail & (LIFE_COMMANDS - 1)] = *command;
+	__atomic_store_n(&simulation->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * Take the next command off the queue, on the simulation thread.
+ *
+ * @Return false if there is none
+ */
+static boolean receiveCommand(LifeSimulation *simulation,
+			      LifeCommand *command)
+{
+	unsigned int head = simulation->head;
+	unsigned int tail = __atomic_load_n(&simulation->tail,
+					    __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		return false;
+	}
+
+	*command = simulation->commands[head & (LIFE_COMMANDS - 1)];
+	__atomic_store_n(&simulation->head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * Copy the current generation into the back frame and hand it over.
+ */
+static void publishFrame(LifeSimulation *simulation)
+{
+	LifeBoard *frame = simulation->frames[simulation->back];
+	LifeBoard *board = simulation->board;
+
+	if (simulation->sparse) {
+		copyFromSparseBoard(simulation->sparse, board, 0, 0);
+	}
+	for (int y = 0; y < board->boardSize; y++) {
+		(void)memcpy(lifeRow(frame, y), lifeRow(board, y),
+			     sizeof(uint64_t) * board->words);
+	}
+	simulation->frameGenerations[simulation->back] = simulation->generation;
+
+	int back = __atomic_exchange_n(&simulation->middle,
+				       simulation->back | LIFE_FRAME_FRESH,
+				       __ATOMIC_ACQ_REL);
+	simulation->back = back & ~LIFE_FRAME_FRESH;
+}
+
+/**
+ * The latest finished generation, which stays the caller's to read until
+ * the next call. Never waits for the simulation.
+ */
+LifeBoard *readFrame(LifeSimulation *simulation,
+		     unsigned long long *generation)
+{
+	if (__atomic_load_n(&simulation->middle, __ATOMIC_ACQUIRE) &
+	    LIFE_FRAME_FRESH) {
+		int front = __atomic_exchange_n(&simulation->middle,
+						simulation->front,
+						__ATOMIC_ACQ_REL);
+		simulation->front = front & ~LIFE_FRAME_FRESH;
+	}
+
+	if (generation != NULL) {
+		*generation = simulation->frameGenerations[simulation->front];
+	}
+
+	return simulation->frames[simulation->front];
+}
+
+/**
+ * Flip a cell, on the sparse board if there is one.
+ */
+static void toggleCell(LifeSimulation *simulation, int x, int y)
+{
+	if (simulation->sparse) {
+		(void)setSparseCell(simulation->sparse, x, y,
+				    !getSparseCell(simulation->sparse, x, y));
+	} else {
+		(void)setCell(simulation->board, x, y,
+			      !getCell(simulation->board, x, y));
+	}
+}
+
+/**
+ * Hand a new generation to the checkpoint writer, the stream and the
+ * statistics file, if they want it. Only the last of them may wait for
+ * the disk, once its buffer is full.
+ */
+static void writeGeneration(LifeSimulation *simulation)
+{
+	if (simulation->checkpoint && simulation->checkpointInterval > 0 &&
+	    simulation->generation % simulation->checkpointInterval == 0) {
+		(void)requestCheckpoint(simulation->checkpoint,
+					simulation->board,
+					simulation->generation);
+	}
+
+	(void)streamGeneration(simulation->stream, simulation->board,
+			       simulation->generation);
+	writeBoardStatistics(simulation->statistics, simulation->board,
+			     simulation->generation);
+}
+
+/**
+ * Calculate the next generation, or pause if the sparse board has run out
+ * of memory for it.
+ */
+static void calculateGeneration(LifeSimulation *simulation)
+{
+	uint64_t start = startTimer();
+
+	if (simulation->sparse) {
+		if (!calculateSparseLife(simulation->sparse)) {
+			printf("Not possible to allocate memory for sparse "
+			       "board, pausing.\n");
+			(void)fflush(NULL);
+			simulation->paused = true;
+			return;
+		}
+	} else {
+		calculateLifeTopology(simulation->board, simulation->topology);
+	}
+	simulation->generation++;
+	stopTimer(simulation->profile, LIFE_PHASE_STEP, start);
+
+	writeGeneration(simulation);
+}
+
+/**
+ * Jump ahead with HashLife, which only knows about the board.
+ */
+static void jumpGeneration(LifeSimulation *simulation)
+{
+	if (simulation->jumpSize == 0 || simulation->sparse) {
+		return;
+	}
+
+	if (!jumpBoard(simulation->board, simulation->jumpSize,
+		       simulation->maxNodes)) {
+		printf("Not possible to jump that far with the memory "
+		       "for HashLife, not jumping.\n");
+		(void)fflush(NULL);
+		return;
+	}
+
+	simulation->generation += simulation->jumpSize;
+
+	writeGeneration(simulation);
+}
+
+/**
+ * Go back one generation, if it is still in the history.
+ */
+static void stepBack(LifeSimulation *simulation)
+{
+	simulation->paused = true;
+
+	if (simulation->generation == 0 ||
+	    !seekGeneration(simulation->history, simulation->board,
+			    simulation->generation - 1)) {
+		printf("Generation %llu is not in the history.\n",
+		       simulation->generation - 1);
+		(void)fflush(NULL);
+		return;
+	}
+
+	simulation->generation--;
+}
+
+/**
+ * Main loop of the simulation thread: carry out the commands, then
+ * calculate and hand over the next generation unless paused.
+ */
+static void *runSimulation(void *arg)
+{
+	LifeSimulation *simulation = (LifeSimulation *)arg;
+	LifeCommand command;
+
+	for (;;) {
+		boolean changed = false;
+		boolean step = false;
+
+		while (receiveCommand(simulation, &command)) {
+			switch (command.type) {
+			case LIFE_TOGGLE_CELL:
+				toggleCell(simulation, command.x, command.y);
+				changed = true;
+				break;
+			case LIFE_PAUSE:
+				simulation->paused = !simulation->paused;
+				break;
+			case LIFE_STEP:
+				simulation->paused = true;
+				step = true;
+				break;
+			case LIFE_JUMP:
+				jumpGeneration(simulation);
+				recordGeneration(simulation->history,
+						 simulation->board,
+						 simulation->generation);
+				changed = true;
+				break;
+			case LIFE_BACK:
+				stepBack(simulation);
+				changed = true;
+				break;
+			case LIFE_DELAY:
+				simulation->delay = command.delay;
+				break;
+			case LIFE_QUIT:
+				return NULL;
+			}
+		}
+
+		if (!simulation->paused || step) {
+			calculateGeneration(simulation);
+			uint64_t start = startTimer();
+			recordGeneration(simulation->history, simulation->board,
+					 simulation->generation);
+			stopTimer(simulation->profile, LIFE_PHASE_HISTORY,
+				  start);
+			publishFrame(simulation);
+			sleepSeconds(simulation->delay);
+		} else {
+			if (changed) {
+				publishFrame(simulation);
+			}
+			sleepSeconds(PAUSE_SLEEP);
+		}
+	}
+}
+
+/**
+ * Start the simulation thread, which owns the boards until stopped.
+ *
+ * @Return false if the thread could not be started
+ */
+boolean startSimulation(LifeSimulation *simulation)
+{
+	if (simulation == NULL || simulation->started) {
+		return false;
+	}
+
+	// there is a frame to show from the start.
+	recordGeneration(simulation->history, simulation->board,
+			 simulation->generation);
+	publishFrame(simulation);
+	if (pthread_create(&simulation->thread, NULL, &runSimulation,
+			   simulation) != 0) {
+		return false;
+	}
+	simulation->started = true;
+
+	return true;
+}
+
+/**
+ * Ask the simulation thread to stop after the generation it is on, and
+ * wait for it.
+ */
+void stopSimulation(LifeSimulation *simulation)
+{
+	LifeCommand quit = { LIFE_QUIT, 0, 0, 0.0f };
+
+	if (simulation == NULL || !simulation->started) {
+		return;
+	}
+
+	// the queue empties as long as the thread runs.
+	while (!sendCommand(simulation, &quit)) {
+		sleepSeconds(PAUSE_SLEEP);
+	}
+	(void)pthread_join(simulation->thread, NULL);
+	simulation->started = false;
+}
@@ -0,0 +1,122 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_SIMULATION_H_
+#define __GOL_SIMULATION_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "gol_backend.h"
+#include "gol_history.h"
+#include "gol_profile.h"
+#include "gol_snapshot.h"
+#include "gol_sparse.h"
+#include "gol_stream.h"
+
+typedef enum LifeCommandType
+{
+	LIFE_TOGGLE_CELL = 0,
+	LIFE_PAUSE,
+	LIFE_STEP,
+	LIFE_JUMP,
+	LIFE_DELAY,
+	LIFE_BACK,
+	LIFE_QUIT
+} LifeCommandType;
+
+/*
+ * Something for the simulation to do between generations: flip the cell
+ * at (x, y), pause or resume, calculate a single generation, jump ahead,
+ * wait delay seconds between generations from now on, or go back one
+ * generation in the history.
+ */
+typedef struct LifeCommand
+{
+	LifeCommandType type;
+	int x;
+	int y;
+	float delay;
+} LifeCommand;
+
+/* Commands that can be waiting at once, a power of two. */
+#define LIFE_COMMANDS 256
+
+/* Set in middle when it holds a frame the reader has not seen. */
+#define LIFE_FRAME_FRESH 4
+
+/*
+ * A simulation running on a thread of its own, handing every finished
+ * generation to the thread drawing it through three frames. The
+ * simulation fills the back frame and swaps it with the middle one, and
+ * the reader swaps the middle frame with its front one when there is a
+ * fresh one, neither of them ever waiting for the other.
+ *
+ * Commands go the other way through a ring buffer with one writer and
+ * one reader. Only the reader of frames may send commands.
+ *
+ * Every generation calculated is recorded in the history, if there is one,
+ * to step back through, and every checkpointInterval generations the board
+ * is handed to the checkpoint writer, if there is one. Every generation
+ * calculated or jumped to also goes to the stream, if there is one, and
+ * its statistics to the statistics file, if there is one. How long each
+ * generation took to calculate and to record goes to the profile, if there
+ * is one. The board is calculated in its topology, a torus unless set
+ * otherwise.
+ */
+typedef struct LifeSimulation
+{
+	LifeBoard *board;
+	SparseBoard *sparse;
+	LifeHistory *history;
+	LifeCheckpoint *checkpoint;
+	unsigned long long checkpointInterval;
+	LifeStream *stream;
+	FILE *statistics;
+	LifeProfile *profile;
+	LifeBoard *frames[3];
+	unsigned long long frameGenerations[3];
+	int back;
+	int front;
+	int middle;
+	LifeCommand commands[LIFE_COMMANDS];
+	unsigned int head;
+	unsigned int tail;
+	pthread_t thread;
+	boolean started;
+	boolean paused;
+	float delay;
+	unsigned long long generation;
+	unsigned long long jumpSize;
+	size_t maxNodes;
+	LifeTopology topology;
+} LifeSimulation;
+
+LifeSimulation *createSimulation(LifeBoard *, SparseBoard *,
+				 unsigned long long);
+void destroySimulation(LifeSimulation *);
+boolean startSimulation(LifeSimulation *);
+void stopSimulation(LifeSimulation *);
+boolean sendCommand(LifeSimulation *, const LifeCommand *);
+LifeBoard *readFrame(LifeSimulation *, unsigned long long *);
+
+#endif
@@ -0,0 +1,325 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gol_snapshot.h"
+
+#define MAX_PATH 4096
+
+/**
+ * Fold a row of words into a checksum.
+ */
+static uint64_t checksumWords(uint64_t checksum, const uint64_t *words,
+			      int count)
+{
+	for (int i = 0; i < count; i++) {
+		checksum = (checksum ^ words[i]) * 0x100000001b3ULL;
+		checksum ^= checksum >> 32;
+	}
+
+	return checksum;
+}
+
+/**
+ * Write the board to path as a snapshot of the given generation and
+ * rule. It is written next to path first and then renamed over it, so
+ * there is always a whole snapshot at path.
+ *
+ * @Return false if the file could not be written
+ */
+boolean saveSnapshot(LifeBoard *board, unsigned long long generation,
+		     const LifeRule *rule, const char *path)
+{
+	LifeSnapshotHeader header;
+	char temporary[MAX_PATH];
+
+	if (board == NULL || rule == NULL || path == NULL ||
+	    snprintf(temporary, MAX_PATH, "%s.tmp", path) >= MAX_PATH) {
+		return false;
+	}
+
+	(void)memset(&header, 0x0, sizeof(header));
+	(void)memcpy(header.magic, LIFE_SNAPSHOT_MAGIC,
+		     sizeof(LIFE_SNAPSHOT_MAGIC));
+	header.version = LIFE_SNAPSHOT_VERSION;
+	header.headerSize = sizeof(header);
+	header.boardSize = (uint32_t)board->boardSize;
+	header.words = (uint32_t)board->words;
+	header.generation = generation;
+	header.birth = rule->birth;
+	header.survival = rule->survival;
+	header.dataOffset = sizeof(header);
+
+	uint64_t *row = (uint64_t *)malloc(sizeof(uint64_t) * board->words);
+	FILE *file = fopen(temporary, "wb");
+	boolean ok = row != NULL && file != NULL &&
+		fwrite(&header, sizeof(header), 1, file) == 1;
+
+	int tail = board->boardSize % 64;
+	uint64_t mask = tail ? ((uint64_t)1 << tail) - 1 : ~(uint64_t)0;
+	uint64_t checksum = 0;
+	for (int y = 0; ok && y < board->boardSize; y++) {
+		(void)memcpy(row, lifeRow(board, y),
+			     sizeof(uint64_t) * board->words);
+		row[board->words - 1] &= mask;
+		checksum = checksumWords(checksum, row, board->words);
+		ok = fwrite(row, sizeof(uint64_t), (size_t)board->words,
+			    file) == (size_t)board->words;
+	}
+
+	// now that the checksum is known, write the header again.
+	header.checksum = checksum;
+	ok = ok && fseek(file, 0, SEEK_SET) == 0 &&
+		fwrite(&header, sizeof(header), 1, file) == 1;
+
+	if (file != NULL && fclose(file) != 0) {
+		ok = false;
+	}
+	free(row);
+
+	if (ok && rename(temporary, path) != 0) {
+		ok = false;
+	}
+	if (!ok) {
+		(void)unlink(temporary);
+	}
+
+	return ok;
+}
+
+/**
+ * Load a snapshot by mapping the file into memory and copying the rows
+ * straight into a new board, checking the checksum on the way.
+ *
+ * @Return the board, or NULL if the file is missing, not a snapshot of
+ * this version, cut short or corrupt, or there is not enough memory
+ */
+LifeBoard *loadSnapshot(const char *path, unsigned long long *generation,
+			LifeRule *rule)
+{
+	struct stat status;
+	LifeBoard *board = NULL;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &status) != 0 ||
+	    (size_t)status.st_size < sizeof(LifeSnapshotHeader)) {
+		(void)close(fd);
+		return NULL;
+	}
+
+	size_t size = (size_t)status.st_size;
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+	(void)madvise(map, size, MADV_SEQUENTIAL);
+
+	const LifeSnapshotHeader *header = (const LifeSnapshotHeader *)map;
+	int words = (int)((header->boardSize + 63) / 64);
+	boolean ok = memcmp(header->magic, LIFE_SNAPSHOT_MAGIC,
+			    sizeof(LIFE_SNAPSHOT_MAGIC)) == 0 &&
+		header->version == LIFE_SNAPSHOT_VERSION &&
+		header->headerSize == sizeof(LifeSnapshotHeader) &&
+		header->boardSize > 0 && header->boardSize <= 0x7fffffff &&
+		header->words == (uint32_t)words &&
+		header->dataOffset % sizeof(uint64_t) == 0 &&
+		header->dataOffset <= size &&
+		(size - header->dataOffset) / sizeof(uint64_t) / words >=
+		header->boardSize;
+
+	if (ok) {
+		board = createLifeBoard((int)header->boardSize);
+	}
+
+	if (board != NULL) {
+		const uint64_t *cells = (const uint64_t *)
+			((const char *)map + header->dataOffset);
+		uint64_t checksum = 0;
+
+		for (int y = 0; y < board->boardSize; y++) {
+			const uint64_t *row = cells + (size_t)y * words;
+			checksum = checksumWords(checksum, row, words);
+			(void)memcpy(lifeRow(board, y), row,
+				     sizeof(uint64_t) * words);
+		}
+		markBoardChanged(board);
+
+		if (checksum != header->checksum) {
+			destroyLifeBoard(board);
+			board = NULL;
+		}
+	}
+
+	if (board != NULL) {
+		if (generation != NULL) {
+			*generation = header->generation;
+		}
+		if (rule != NULL) {
+			rule->birth = header->birth;
+			rule->survival = header->survival;
+		}
+	}
+
+	(void)munmap(map, size);
+
+	return board;
+}
+
+/**
+ * Main loop of the checkpoint thread; wait for a copy of the board and
+ * write it out.
+ */
+static void *runCheckpoint(void *arg)
+{
+	LifeCheckpoint *checkpoint = (LifeCheckpoint *)arg;
+
+	(void)pthread_mutex_lock(&checkpoint->lock);
+	for (;;) {
+		while (!checkpoint->pending && !checkpoint->stopping) {
+			(void)pthread_cond_wait(&checkpoint->wake,
+						&checkpoint->lock);
+		}
+		if (!checkpoint->pending) {
+			break;
+		}
+		(void)pthread_mutex_unlock(&checkpoint->lock);
+
+		if (!saveSnapshot(checkpoint->board, checkpoint->generation,
+				  &checkpoint->rule, checkpoint->path)) {
+			fprintf(stderr, "Not possible to write a checkpoint "
+				"to %s.\n", checkpoint->path);
+		}
+
+		(void)pthread_mutex_lock(&checkpoint->lock);
+		checkpoint->pending = false;
+	}
+	(void)pthread_mutex_unlock(&checkpoint->lock);
+
+	return NULL;
+}
+
+/**
+ * Start a thread writing checkpoints of boards of the given size to path.
+ *
+ * @Return the checkpoint writer, or NULL if out of memory or threads
+ */
+LifeCheckpoint *createCheckpoint(const char *path, int boardSize)
+{
+	LifeCheckpoint *checkpoint =
+		(LifeCheckpoint *)calloc(1, sizeof(LifeCheckpoint));
+	if (checkpoint == NULL) {
+		return NULL;
+	}
+
+	checkpoint->path = strdup(path);
+	checkpoint->board = createLifeBoard(boardSize);
+	if (checkpoint->path == NULL || checkpoint->board == NULL) {
+		free(checkpoint->path);
+		destroyLifeBoard(checkpoint->board);
+		free(checkpoint);
+		return NULL;
+	}
+
+	(void)pthread_mutex_init(&checkpoint->lock, NULL);
+	(void)pthread_cond_init(&checkpoint->wake, NULL);
+	if (pthread_create(&checkpoint->thread, NULL, &runCheckpoint,
+			   checkpoint) != 0) {
+		(void)pthread_cond_destroy(&checkpoint->wake);
+		(void)pthread_mutex_destroy(&checkpoint->lock);
+		free(checkpoint->path);
+		destroyLifeBoard(checkpoint->board);
+		free(checkpoint);
+		return NULL;
+	}
+
+	return checkpoint;
+}
+
+/**
+ * Finish writing the checkpoint under way, if any, and stop the thread.
+ */
+void destroyCheckpoint(LifeCheckpoint *checkpoint)
+{
+	if (checkpoint == NULL) {
+		return;
+	}
+
+	(void)pthread_mutex_lock(&checkpoint->lock);
+	checkpoint->stopping = true;
+	(void)pthread_cond_signal(&checkpoint->wake);
+	(void)pthread_mutex_unlock(&checkpoint->lock);
+	(void)pthread_join(checkpoint->thread, NULL);
+
+	(void)pthread_cond_destroy(&checkpoint->wake);
+	(void)pthread_mutex_destroy(&checkpoint->lock);
+	free(checkpoint->path);
+	destroyLifeBoard(checkpoint->board);
+	free(checkpoint);
+}
+
+/**
+ * Copy the board and have it written in the background, unless the last
+ * checkpoint is still being written.
+ *
+ * @Return false if the checkpoint was skipped
+ */
+boolean requestCheckpoint(LifeCheckpoint *checkpoint, LifeBoard *board,
+			  unsigned long long generation)
+{
+	if (checkpoint == NULL || board == NULL ||
+	    board->boardSize != checkpoint->board->boardSize) {
+		return false;
+	}
+
+	(void)pthread_mutex_lock(&checkpoint->lock);
+	boolean busy = checkpoint->pending;
+	(void)pthread_mutex_unlock(&checkpoint->lock);
+	if (busy) {
+		return false;
+	}
+
+	// the writer leaves the copy alone until pending is set.
+	for (int y = 0; y < board->boardSize; y++) {
+		(void)memcpy(lifeRow(checkpoint->board, y), lifeRow(board, y),
+			     sizeof(uint64_t) * board->words);
+	}
+
+	(void)pthread_mutex_lock(&checkpoint->lock);
+	checkpoint->generation = generation;
+	checkpoint->rule = lifeRule;
+	checkpoint->pending = true;
+	(void)pthread_cond_signal(&checkpoint->wake);
+	(void)pthread_mutex_unlock(&checkpoint->lock);
+
+	return true;
+}
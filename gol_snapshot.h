@@ -0,0 +1,84 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_SNAPSHOT_H_
+#define __GOL_SNAPSHOT_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "gol_backend.h"
+#include "gol_kernel.h"
+
+#define LIFE_SNAPSHOT_MAGIC   "GOLSNAP"
+#define LIFE_SNAPSHOT_VERSION 1
+
+/*
+ * The header at the start of a snapshot file, in the byte order of the
+ * machine that wrote it, which has to be little endian. The cells follow
+ * at dataOffset, which keeps them aligned, as words rows of 64 cells at a
+ * time, with cell x of a row in bit x % 64 of word x / 64 and the bits
+ * past the edge cleared. The checksum covers the cells.
+ */
+typedef struct LifeSnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t boardSize;
+	uint32_t words;
+	uint64_t generation;
+	uint16_t birth;
+	uint16_t survival;
+	uint32_t reserved;
+	uint64_t checksum;
+	uint64_t dataOffset;
+	uint64_t padding;
+} LifeSnapshotHeader;
+
+/*
+ * Snapshots written in the background by a thread of its own, from a copy
+ * of the board taken between generations, so that the simulation only
+ * has to wait for the copy.
+ */
+typedef struct LifeCheckpoint
+{
+	char *path;
+	LifeBoard *board;
+	unsigned long long generation;
+	LifeRule rule;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	boolean pending;
+	boolean stopping;
+} LifeCheckpoint;
+
+boolean saveSnapshot(LifeBoard *, unsigned long long, const LifeRule *,
+		     const char *);
+LifeBoard *loadSnapshot(const char *, unsigned long long *, LifeRule *);
+
+LifeCheckpoint *createCheckpoint(const char *, int);
+void destroyCheckpoint(LifeCheckpoint *);
+boolean requestCheckpoint(LifeCheckpoint *, LifeBoard *, unsigned long long);
+
+#endif
@@ -0,0 +1,286 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_period.h"
+#include "gol_soup.h"
+
+/**
+ * Create a batch of soups, to be run on boards of boardSize until they
+ * repeat one of the last window generations or reach generations.
+ *
+ * @Return the batch, or NULL if out of memory or the board is too small
+ * for a soup
+ */
+SoupSearch *createSoupSearch(int boardSize, unsigned long long soups,
+			     uint64_t seed, unsigned long long generations,
+			     unsigned long long window)
+{
+	if (boardSize < SOUP_SIZE || soups == 0 || soups > UINT32_MAX ||
+	    window == 0) {
+		return NULL;
+	}
+
+	SoupSearch *search = (SoupSearch *)calloc(1, sizeof(SoupSearch));
+	if (search == NULL) {
+		return NULL;
+	}
+
+	search->boardSize = boardSize;
+	search->seed = seed;
+	search->soups = soups;
+	search->generations = generations;
+	search->window = window;
+	search->results = (SoupResult *)calloc(soups, sizeof(SoupResult));
+	if (search->results == NULL) {
+		free(search);
+		return NULL;
+	}
+
+	return search;
+}
+
+/**
+ *
+ *
+ */
+void destroySoupSearch(SoupSearch *search)
+{
+	if (search == NULL) {
+		return;
+	}
+
+	free(search->results);
+	free(search->ranges);
+	free(search);
+}
+
+/**
+ * Take the first soup left to a thread.
+ *
+ * @Return false if there are none
+ */
+static boolean takeSoup(SoupRange *range, uint32_t *soup)
+{
+	uint64_t soups = __atomic_load_n(&range->soups, __ATOMIC_ACQUIRE);
+
+	for (;;) {
+		uint32_t first = (uint32_t)(soups >> 32);
+		uint32_t end = (uint32_t)soups;
+		if (first >= end) {
+			return false;
+		}
+
+		uint64_t rest = ((uint64_t)(first + 1) << 32) | end;
+		if (__atomic_compare_exchange_n(&range->soups, &soups, rest,
+						false, __ATOMIC_ACQ_REL,
+						__ATOMIC_ACQUIRE)) {
+			*soup = first;
+			return true;
+		}
+	}
+}
+
+/**
+ * Steal the back half of the soups left to another thread, looking at the
+ * threads after the thief first, into the empty range of the thief.
+ *
+ * @Return false if every other thread is out of soups as well
+ */
+static boolean stealSoups(SoupSearch *search, int thief)
+{
+	for (int i = 1; i < search->threads; i++) {
+		SoupRange *victim = &search->ranges[(thief + i) %
+						    search->threads];
+		uint64_t soups = __atomic_load_n(&victim->soups,
+						 __ATOMIC_ACQUIRE);
+
+		for (;;) {
+			uint32_t first = (uint32_t)(soups >> 32);
+			uint32_t end = (uint32_t)soups;
+			if (first >= end) {
+				break;
+			}
+
+			uint32_t middle = first + (end - first) / 2;
+			uint64_t kept = ((uint64_t)first << 32) | middle;
+			if (__atomic_compare_exchange_n(&victim->soups, &soups,
+							kept, false,
+							__ATOMIC_ACQ_REL,
+							__ATOMIC_ACQUIRE)) {
+				__atomic_store_n(&search->ranges[thief].soups,
+						 ((uint64_t)middle << 32) | end,
+						 __ATOMIC_RELEASE);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Fill a square of SOUP_SIZE cells in the middle of an empty board with
+ * random cells from seed, half of them alive.
+ */
+static void fillSoup(LifeBoard *board, uint64_t seed)
+{
+	int offset = (board->boardSize - SOUP_SIZE) / 2;
+
+	for (int y = 0; y < board->boardSize; y++) {
+		(void)memset(lifeRow(board, y), 0x0,
+			     sizeof(uint64_t) * board->words);
+	}
+
+	for (int y = 0; y < SOUP_SIZE; y++) {
+		uint64_t cells = randomWord(seed, (uint64_t)y);
+		for (int x = 0; x < SOUP_SIZE; x++) {
+			if (cells >> x & 1) {
+				(void)setCell(board, offset + x, offset + y,
+					      true);
+			}
+		}
+	}
+
+	markBoardChanged(board);
+}
+
+/**
+ * @Return the number of live cells on the board
+ */
+static unsigned long long countCells(LifeBoard *board)
+{
+	unsigned long long population = 0;
+
+	for (int y = 0; y < board->boardSize; y++) {
+		const uint64_t *row = lifeRow(board, y);
+		for (int w = 0; w < board->words; w++) {
+			population += (unsigned long long)
+				__builtin_popcountll(row[w]);
+		}
+	}
+
+	return population;
+}
+
+/**
+ * Run one soup until it repeats itself or reaches the cap.
+ */
+static void runSoup(SoupSearch *search, LifeBoard *board, LifePeriod *period,
+		    uint32_t soup)
+{
+	SoupResult *result = &search->results[soup];
+	result->seed = randomWord(search->seed ^ ((uint64_t)soup << 32), 0);
+	fillSoup(board, result->seed);
+
+	resetPeriodDetector(period);
+	boolean repeated = detectPeriod(period, getBoardHash(board), 0);
+	unsigned long long generation = 0;
+	while (!repeated && generation < search->generations) {
+		calculateLife(board);
+		generation++;
+		repeated = detectPeriod(period, getBoardHash(board),
+					generation);
+	}
+
+	result->generations = repeated ? period->start : generation;
+	result->period = repeated ? period->period : 0;
+	result->population = countCells(board);
+}
+
+/**
+ * Worker task running soups on a board of its own until there are none
+ * left anywhere.
+ */
+static void runSoups(void *arg, int index, int count)
+{
+	SoupSearch *search = (SoupSearch *)arg;
+	LifeBoard *board = createLifeBoard(search->boardSize);
+	LifePeriod *period = createPeriodDetector(search->window);
+
+	(void)count;
+	if (board == NULL || period == NULL || !enableBoardHash(board)) {
+		__atomic_store_n(&search->failed, 1, __ATOMIC_RELAXED);
+	} else {
+		uint32_t soup;
+		do {
+			while (takeSoup(&search->ranges[index], &soup)) {
+				runSoup(search, board, period, soup);
+			}
+		} while (stealSoups(search, index));
+	}
+
+	destroyPeriodDetector(period);
+	destroyLifeBoard(board);
+}
+
+/**
+ * Run every soup of the batch on the threads of the pool, or on the
+ * calling thread alone without one.
+ *
+ * @Return false if out of memory
+ */
+boolean runSoupSearch(SoupSearch *search, WorkerPool *pool)
+{
+	if (search == NULL) {
+		return false;
+	}
+
+	search->threads = pool ? pool->threads : 1;
+	free(search->ranges);
+	search->ranges = NULL;
+	if (posix_memalign((void **)&search->ranges, sizeof(SoupRange),
+			   sizeof(SoupRange) * search->threads) != 0) {
+		return false;
+	}
+
+	for (int i = 0; i < search->threads; i++) {
+		uint64_t first = search->soups * i / search->threads;
+		uint64_t end = search->soups * (i + 1) / search->threads;
+		search->ranges[i].soups = (first << 32) | end;
+	}
+
+	search->failed = 0;
+	runWorkerPool(pool, &runSoups, search);
+
+	return !search->failed;
+}
+
+/**
+ * Write a line of CSV for every soup, in the order of their numbers.
+ */
+void writeSoupResults(FILE *file, const SoupSearch *search)
+{
+	if (file == NULL || search == NULL) {
+		return;
+	}
+
+	fprintf(file, "soup,seed,generations,period,population\n");
+	for (unsigned long long soup = 0; soup < search->soups; soup++) {
+		const SoupResult *result = &search->results[soup];
+		fprintf(file, "%llu,%016llx,%llu,%llu,%llu\n", soup,
+			(unsigned long long)result->seed, result->generations,
+			result->period, result->population);
+	}
+}
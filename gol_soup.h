@@ -0,0 +1,86 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_SOUP_H_
+#define __GOL_SOUP_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gol_backend.h"
+#include "gol_workers.h"
+
+/* Side of the random square every soup starts as, at most a word wide. */
+#define SOUP_SIZE 16
+
+/*
+ * How a soup ended: after how many generations it started going round,
+ * and with what period and how many live cells, or with a period of 0 if
+ * it was still going when it hit the cap.
+ */
+typedef struct SoupResult
+{
+	uint64_t seed;
+	unsigned long long generations;
+	unsigned long long period;
+	unsigned long long population;
+} SoupResult;
+
+/*
+ * The soups left to a thread, the first in the high half and the one past
+ * the last in the low half, so that the thread can take one from the
+ * front and others can steal half from the back with a single compare and
+ * swap. On a cache line of its own.
+ */
+typedef struct SoupRange
+{
+	uint64_t soups;
+	char padding[56];
+} SoupRange;
+
+/*
+ * A batch of soups, each on a board of its own and each with a seed of its
+ * own worked out from the seed of the batch and its number, so that every
+ * soup comes out the same however many threads there are and whichever
+ * of them runs it. The soups are handed out to the threads in even
+ * ranges, and a thread that runs out steals from the others.
+ */
+typedef struct SoupSearch
+{
+	int boardSize;
+	uint64_t seed;
+	unsigned long long soups;
+	unsigned long long generations;
+	unsigned long long window;
+	SoupResult *results;
+	SoupRange *ranges;
+	int threads;
+	int failed;
+} SoupSearch;
+
+SoupSearch *createSoupSearch(int, unsigned long long, uint64_t,
+			     unsigned long long, unsigned long long);
+void destroySoupSearch(SoupSearch *);
+boolean runSoupSearch(SoupSearch *, WorkerPool *);
+void writeSoupResults(FILE *, const SoupSearch *);
+
+#endif
@@ -0,0 +1,549 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_kernel.h"
+#include "gol_sparse.h"
+#include "gol_workers.h"
+
+#define MIN_BUCKETS 1024
+
+/**
+ * The tile holding cell coordinate v, rounding towards minus infinity.
+ */
+static int32_t tileCoordinate(long v)
+{
+	return (int32_t)(v >= 0 ? v / SPARSE_TILE_SIZE :
+			 -((-v + SPARSE_TILE_SIZE - 1) / SPARSE_TILE_SIZE));
+}
+
+/**
+ * Hash tile coordinates, mixed well enough for the low bits to pick the
+ * bucket.
+ */
+static size_t hashTile(int32_t x, int32_t y)
+{
+	uint64_t h = ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+	h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+	h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+
+	return (size_t)(h ^ (h >> 33));
+}
+
+/**
+ * The tile at (x, y), or NULL if there is none. Only reads the map, so it
+ * is safe to call from several workers at once.
+ */
+static SparseTile *findTile(const SparseBoard *sparse, int32_t x, int32_t y)
+{
+	SparseTile *tile =
+		sparse->buckets[hashTile(x, y) & (sparse->bucketCount - 1)];
+	while (tile != NULL && (tile->x != x || tile->y != y)) {
+		tile = tile->next;
+	}
+
+	return tile;
+}
+
+/**
+ * Double the buckets once there are more tiles than buckets, keeping the
+ * chains short.
+ */
+static boolean growBuckets(SparseBoard *sparse)
+{
+	size_t count = sparse->bucketCount * 2;
+	SparseTile **buckets = (SparseTile **)calloc(count, sizeof(SparseTile *));
+	if (buckets == NULL) {
+		return false;
+	}
+
+	for (size_t i = 0; i < sparse->tileCount; i++) {
+		SparseTile *tile = sparse->tiles[i];
+		size_t b = hashTile(tile->x, tile->y) & (count - 1);
+		tile->next = buckets[b];
+		buckets[b] = tile;
+	}
+
+	free(sparse->buckets);
+	sparse->buckets = buckets;
+	sparse->bucketCount = count;
+
+	return true;
+}
+
+/**
+ * The tile at (x, y), made with only dead cells if there is none yet.
+ *
+ * @Return the tile, or NULL if out of memory
+ */
+static SparseTile *addTile(SparseBoard *sparse, int32_t x, int32_t y)
+{
+	SparseTile *tile = findTile(sparse, x, y);
+	if (tile != NULL) {
+		return tile;
+	}
+
+	if (sparse->tileCount == sparse->tileSpace) {
+		size_t space = sparse->tileSpace * 2;
+		SparseTile **tiles = (SparseTile **)realloc(sparse->tiles,
+			sizeof(SparseTile *) * space);
+		if (tiles == NULL) {
+			return NULL;
+		}
+		sparse->tiles = tiles;
+		sparse->tileSpace = space;
+	}
+
+	if (sparse->tileCount >= sparse->bucketCount && !growBuckets(sparse)) {
+		return NULL;
+	}
+
+	tile = (SparseTile *)calloc(1, sizeof(SparseTile));
+	if (tile == NULL) {
+		return NULL;
+	}
+
+	size_t b = hashTile(x, y) & (sparse->bucketCount - 1);
+	tile->x = x;
+	tile->y = y;
+	tile->next = sparse->buckets[b];
+	sparse->buckets[b] = tile;
+	sparse->tiles[sparse->tileCount++] = tile;
+
+	return tile;
+}
+
+/**
+ * Take a tile out of its bucket and free it. The caller takes it out of
+ * the tile list.
+ */
+static void removeTile(SparseBoard *sparse, SparseTile *tile)
+{
+	SparseTile **link =
+		&sparse->buckets[hashTile(tile->x, tile->y) &
+				 (sparse->bucketCount - 1)];
+	while (*link != tile) {
+		link = &(*link)->next;
+	}
+	*link = tile->next;
+
+	free(tile);
+}
+
+/**
+ * Free every tile, leaving a board of only dead cells.
+ */
+static void clearSparseBoard(SparseBoard *sparse)
+{
+	for (size_t i = 0; i < sparse->tileCount; i++) {
+		free(sparse->tiles[i]);
+	}
+	sparse->tileCount = 0;
+	(void)memset(sparse->buckets, 0,
+		     sizeof(SparseTile *) * sparse->bucketCount);
+}
+
+/**
+ * Allocate an empty sparse board.
+ */
+SparseBoard *createSparseBoard(void)
+{
+	SparseBoard *sparse = (SparseBoard *)calloc(1, sizeof(SparseBoard));
+	if (sparse == NULL) {
+		return NULL;
+	}
+
+	sparse->bucketCount = MIN_BUCKETS;
+	sparse->tileSpace = MIN_BUCKETS;
+	sparse->buckets = (SparseTile **)calloc(sparse->bucketCount,
+						sizeof(SparseTile *));
+	sparse->tiles = (SparseTile **)malloc(sizeof(SparseTile *) *
+					      sparse->tileSpace);
+	if (sparse->buckets == NULL || sparse->tiles == NULL) {
+		destroySparseBoard(sparse);
+		return NULL;
+	}
+
+	return sparse;
+}
+
+/**
+ * Free a sparse board and all of its tiles. The worker pool is not its to
+ * free.
+ */
+void destroySparseBoard(SparseBoard *sparse)
+{
+	if (sparse == NULL) {
+		return;
+	}
+
+	if (sparse->tiles != NULL) {
+		for (size_t i = 0; i < sparse->tileCount; i++) {
+			free(sparse->tiles[i]);
+		}
+	}
+	free(sparse->tiles);
+	free(sparse->buckets);
+	free(sparse);
+}
+
+/**
+ * Get the value at (x, y), which may be anywhere.
+ */
+boolean getSparseCell(SparseBoard *sparse, long x, long y)
+{
+	if (sparse == NULL) {
+		return false;
+	}
+
+	SparseTile *tile = findTile(sparse, tileCoordinate(x),
+				    tileCoordinate(y));
+	if (tile == NULL) {
+		return false;
+	}
+
+	uint64_t row = tile->cells[sparse->parity][y & (SPARSE_TILE_SIZE - 1)];
+	return (row >> (x & (SPARSE_TILE_SIZE - 1))) & 1 ? true : false;
+}
+
+/**
+ * Set the value at (x, y), making its tile if needed.
+ *
+ * @Return false if out of memory for the tile
+ */
+boolean setSparseCell(SparseBoard *sparse, long x, long y, boolean state)
+{
+	if (sparse == NULL) {
+		return false;
+	}
+
+	int32_t tx = tileCoordinate(x);
+	int32_t ty = tileCoordinate(y);
+	SparseTile *tile = state ? addTile(sparse, tx, ty) :
+		findTile(sparse, tx, ty);
+	if (state && tile == NULL) {
+		return false;
+	}
+
+	// a dead cell in a missing tile is already dead.
+	if (tile != NULL) {
+		uint64_t *row =
+			&tile->cells[sparse->parity][y & (SPARSE_TILE_SIZE - 1)];
+		uint64_t bit = (uint64_t)1 << (x & (SPARSE_TILE_SIZE - 1));
+		*row = state ? (*row | bit) : (*row & ~bit);
+	}
+
+	return true;
+}
+
+/**
+ * Count the live cells.
+ */
+uint64_t getSparsePopulation(SparseBoard *sparse)
+{
+	uint64_t population = 0;
+
+	if (sparse == NULL) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < sparse->tileCount; i++) {
+		const uint64_t *rows = sparse->tiles[i]->cells[sparse->parity];
+		for (int r = 0; r < SPARSE_TILE_SIZE; r++) {
+			population += (uint64_t)__builtin_popcountll(rows[r]);
+		}
+	}
+
+	return population;
+}
+
+/**
+ * The 64 cells of row y starting at x, which may straddle two tiles.
+ */
+static uint64_t getSparseWord(SparseBoard *sparse, long x, long y)
+{
+	int32_t tx = tileCoordinate(x);
+	int32_t ty = tileCoordinate(y);
+	int r = (int)(y & (SPARSE_TILE_SIZE - 1));
+	int shift = (int)(x & (SPARSE_TILE_SIZE - 1));
+	uint64_t word = 0;
+
+	SparseTile *tile = findTile(sparse, tx, ty);
+	if (tile != NULL) {
+		word = tile->cells[sparse->parity][r] >> shift;
+	}
+
+	if (shift != 0) {
+		tile = findTile(sparse, tx + 1, ty);
+		if (tile != NULL) {
+			word |= tile->cells[sparse->parity][r] <<
+				(SPARSE_TILE_SIZE - shift);
+		}
+	}
+
+	return word;
+}
+
+/**
+ * Bring the 64 cells of row y starting at x to life where bits are set,
+ * which may straddle two tiles.
+ *
+ * @Return false if out of memory
+ */
+static boolean setSparseWord(SparseBoard *sparse, long x, long y,
+			     uint64_t bits)
+{
+	int32_t tx = tileCoordinate(x);
+	int32_t ty = tileCoordinate(y);
+	int r = (int)(y & (SPARSE_TILE_SIZE - 1));
+	int shift = (int)(x & (SPARSE_TILE_SIZE - 1));
+
+	if ((bits << shift) != 0) {
+		SparseTile *tile = addTile(sparse, tx, ty);
+		if (tile == NULL) {
+			return false;
+		}
+		tile->cells[sparse->parity][r] |= bits << shift;
+	}
+
+	if (shift != 0 && (bits >> (SPARSE_TILE_SIZE - shift)) != 0) {
+		SparseTile *tile = addTile(sparse, tx + 1, ty);
+		if (tile == NULL) {
+			return false;
+		}
+		tile->cells[sparse->parity][r] |=
+			bits >> (SPARSE_TILE_SIZE - shift);
+	}
+
+	return true;
+}
+
+/**
+ * Replace the cells of the sparse board with those of the board, its top
+ * left corner placed at (x, y).
+ *
+ * @Return false if out of memory, with only some of the cells copied
+ */
+boolean copyToSparseBoard(SparseBoard *sparse, LifeBoard *lifeBoard,
+			  long x, long y)
+{
+	if (sparse == NULL || lifeBoard == NULL) {
+		return false;
+	}
+
+	clearSparseBoard(sparse);
+
+	for (int row = 0; row < lifeBoard->boardSize; row++) {
+		const uint64_t *cells = lifeRow(lifeBoard, row);
+		for (int w = 0; w < lifeBoard->words; w++) {
+			if (cells[w] != 0 &&
+			    !setSparseWord(sparse,
+					   x + (long)w * SPARSE_TILE_SIZE,
+					   y + row, cells[w])) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Copy the square of the sparse board the size of the board, with its top
+ * left corner at (x, y), into the board.
+ */
+void copyFromSparseBoard(SparseBoard *sparse, LifeBoard *lifeBoard,
+			 long x, long y)
+{
+	if (sparse == NULL || lifeBoard == NULL) {
+		return;
+	}
+
+	int n = lifeBoard->boardSize;
+	int tail = n % SPARSE_TILE_SIZE;
+	uint64_t mask = tail ? ((uint64_t)1 << tail) - 1 : ~(uint64_t)0;
+
+	for (int row = 0; row < n; row++) {
+		uint64_t *cells = lifeRow(lifeBoard, row);
+		for (int w = 0; w < lifeBoard->words; w++) {
+			cells[w] = getSparseWord(sparse,
+						 x + (long)w * SPARSE_TILE_SIZE,
+						 y + row);
+		}
+		cells[lifeBoard->words - 1] &= mask;
+	}
+
+	markBoardChanged(lifeBoard);
+}
+
+/**
+ * Make sure the tiles next to live cells on the edge of a tile are there,
+ * so the cells can spread into them. Only the tiles there were at the
+ * start are looked at, as the new ones have only dead cells.
+ *
+ * @Return false if out of memory, with only some of the tiles made
+ */
+static boolean expandTiles(SparseBoard *sparse)
+{
+	size_t count = sparse->tileCount;
+
+	for (size_t i = 0; i < count; i++) {
+		SparseTile *tile = sparse->tiles[i];
+		const uint64_t *rows = tile->cells[sparse->parity];
+		uint64_t columns = 0;
+		for (int r = 0; r < SPARSE_TILE_SIZE; r++) {
+			columns |= rows[r];
+		}
+		if (columns == 0) {
+			continue;
+		}
+
+		uint64_t top = rows[0];
+		uint64_t bottom = rows[SPARSE_TILE_SIZE - 1];
+		uint64_t west = 1;
+		uint64_t east = (uint64_t)1 << (SPARSE_TILE_SIZE - 1);
+		int32_t x = tile->x;
+		int32_t y = tile->y;
+
+		if ((top != 0 && addTile(sparse, x, y - 1) == NULL) ||
+		    (bottom != 0 && addTile(sparse, x, y + 1) == NULL) ||
+		    ((columns & west) && addTile(sparse, x - 1, y) == NULL) ||
+		    ((columns & east) && addTile(sparse, x + 1, y) == NULL) ||
+		    ((top & west) && addTile(sparse, x - 1, y - 1) == NULL) ||
+		    ((top & east) && addTile(sparse, x + 1, y - 1) == NULL) ||
+		    ((bottom & west) &&
+		     addTile(sparse, x - 1, y + 1) == NULL) ||
+		    ((bottom & east) &&
+		     addTile(sparse, x + 1, y + 1) == NULL)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Row r of the current generation of a tile, or dead cells if it is
+ * missing.
+ */
+static uint64_t tileRow(const SparseBoard *sparse, const SparseTile *tile,
+			int r)
+{
+	return tile != NULL ? tile->cells[sparse->parity][r] : 0;
+}
+
+/**
+ * Calculate the next generation of one tile. Its rows are laid out with
+ * the ones of the tiles west and east of it on either side, and with the
+ * bordering rows of the tiles above and below, so the row kernel can run
+ * over it as if it was a board three words wide.
+ */
+static void calculateTile(const SparseBoard *sparse, SparseTile *tile)
+{
+	uint64_t strip[SPARSE_TILE_SIZE + 2][3];
+	const SparseTile *around[3][3];
+	unsigned char changes = 0;
+	int last = SPARSE_TILE_SIZE - 1;
+
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			around[dy + 1][dx + 1] = dx == 0 && dy == 0 ? tile :
+				findTile(sparse, tile->x + dx, tile->y + dy);
+		}
+	}
+
+	for (int i = 0; i < 3; i++) {
+		strip[0][i] = tileRow(sparse, around[0][i], last);
+		strip[SPARSE_TILE_SIZE + 1][i] = tileRow(sparse, around[2][i], 0);
+		for (int r = 0; r < SPARSE_TILE_SIZE; r++) {
+			strip[r + 1][i] = tileRow(sparse, around[1][i], r);
+		}
+	}
+
+	uint64_t *out = tile->cells[sparse->parity ^ 1];
+	for (int r = 0; r < SPARSE_TILE_SIZE; r++) {
+		lifeRowKernel(&strip[r][1], &strip[r + 1][1], &strip[r + 2][1],
+			      &out[r], 1, &changes);
+	}
+}
+
+/**
+ * Worker task, calculating every count-th tile from index on.
+ */
+static void calculateTiles(void *arg, int index, int count)
+{
+	SparseBoard *sparse = (SparseBoard *)arg;
+
+	for (size_t i = (size_t)index; i < sparse->tileCount; i += count) {
+		calculateTile(sparse, sparse->tiles[i]);
+	}
+}
+
+/**
+ * Free the tiles where every cell has died.
+ */
+static void sweepTiles(SparseBoard *sparse)
+{
+	size_t kept = 0;
+
+	for (size_t i = 0; i < sparse->tileCount; i++) {
+		SparseTile *tile = sparse->tiles[i];
+		const uint64_t *rows = tile->cells[sparse->parity];
+		uint64_t any = 0;
+		for (int r = 0; r < SPARSE_TILE_SIZE; r++) {
+			any |= rows[r];
+		}
+
+		if (any != 0) {
+			sparse->tiles[kept++] = tile;
+		} else {
+			removeTile(sparse, tile);
+		}
+	}
+
+	sparse->tileCount = kept;
+}
+
+/**
+ * Calculate the next generation of the sparse board, with the tiles split
+ * between the workers if there are any.
+ *
+ * @Return false if out of memory for the tiles the cells spread into,
+ * leaving the board at the generation it was
+ */
+boolean calculateSparseLife(SparseBoard *sparse)
+{
+	if (sparse == NULL) {
+		return false;
+	}
+
+	if (!expandTiles(sparse)) {
+		return false;
+	}
+	runWorkerPool(sparse->workers, &calculateTiles, sparse);
+	sparse->parity ^= 1;
+	sweepTiles(sparse);
+
+	return true;
+}
@@ -0,0 +1,76 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_SPARSE_H_
+#define __GOL_SPARSE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gol_backend.h"
+
+#define SPARSE_TILE_SIZE 64
+
+/*
+ * A square of 64x64 cells, one word per row, at tile coordinates (x, y),
+ * that is cells (64x, 64y) and on. The cells are double buffered, with the
+ * current generation in cells[parity] of the board.
+ */
+typedef struct SparseTile
+{
+	int32_t x;
+	int32_t y;
+	uint64_t cells[2][SPARSE_TILE_SIZE];
+	struct SparseTile *next;
+} SparseTile;
+
+/*
+ * An unbounded board holding only the tiles with live cells in them, and
+ * the ones next to those that the live cells may spread into, found
+ * through a hash map from tile coordinates to tiles. Tiles are made when
+ * cells along their edges come to life and freed when they die out, so
+ * rules where dead cells are born with no neighbours cannot be run.
+ */
+typedef struct SparseBoard
+{
+	SparseTile **buckets;
+	SparseTile **tiles;
+	size_t bucketCount;
+	size_t tileCount;
+	size_t tileSpace;
+	int parity;
+	struct WorkerPool *workers;
+} SparseBoard;
+
+SparseBoard *createSparseBoard(void);
+void destroySparseBoard(SparseBoard *);
+
+boolean getSparseCell(SparseBoard *, long, long);
+boolean setSparseCell(SparseBoard *, long, long, boolean);
+uint64_t getSparsePopulation(SparseBoard *);
+
+boolean copyToSparseBoard(SparseBoard *, LifeBoard *, long, long);
+void copyFromSparseBoard(SparseBoard *, LifeBoard *, long, long);
+
+boolean calculateSparseLife(SparseBoard *);
+
+#endif
@@ -0,0 +1,268 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol_history.h"
+#include "gol_stream.h"
+
+/**
+ * Encode a frame against the one written before it and write it out.
+ *
+ * @Return false if it could not be written
+ */
+static boolean writeFrame(LifeStream *stream, const uint64_t *frame,
+			  unsigned long long generation)
+{
+	LifeStreamRecord record;
+	boolean keyframe = stream->written % LIFE_STREAM_KEY_INTERVAL == 0;
+
+	(void)memset(&record, 0x0, sizeof(record));
+	record.generation = generation;
+	record.keyframe = keyframe;
+	record.length = encodeDelta((const unsigned char *)frame,
+				    keyframe ? NULL :
+				    (const unsigned char *)stream->previous,
+				    sizeof(uint64_t) * stream->boardWords,
+				    stream->scratch);
+
+	stream->written++;
+
+	return fwrite(&record, sizeof(record), 1, stream->file) == 1 &&
+		fwrite(stream->scratch, 1, (size_t)record.length,
+		       stream->file) == (size_t)record.length;
+}
+
+/**
+ * Main loop of the writer thread; write the queued frames in order, and
+ * what is left of them once stopping.
+ */
+static void *runStream(void *arg)
+{
+	LifeStream *stream = (LifeStream *)arg;
+
+	(void)pthread_mutex_lock(&stream->lock);
+	for (;;) {
+		while (stream->count == 0 && !stream->stopping) {
+			(void)pthread_cond_wait(&stream->wake, &stream->lock);
+		}
+		if (stream->count == 0) {
+			break;
+		}
+		uint64_t *frame = stream->frames[stream->head];
+		unsigned long long generation =
+			stream->generations[stream->head];
+		(void)pthread_mutex_unlock(&stream->lock);
+
+		if (!stream->failed && !writeFrame(stream, frame, generation)) {
+			stream->failed = true;
+		}
+
+		// the frame written is the base of the next one.
+		(void)pthread_mutex_lock(&stream->lock);
+		stream->frames[stream->head] = stream->previous;
+		stream->previous = frame;
+		stream->head = (stream->head + 1) % LIFE_STREAM_QUEUE;
+		stream->count--;
+		(void)pthread_cond_signal(&stream->space);
+	}
+	(void)pthread_mutex_unlock(&stream->lock);
+
+	return NULL;
+}
+
+/**
+ * Free a stream that has no thread running.
+ */
+static void freeStream(LifeStream *stream)
+{
+	if (stream->file != NULL && stream->closeFile) {
+		(void)fclose(stream->file);
+	}
+	for (int i = 0; i < LIFE_STREAM_QUEUE; i++) {
+		free(stream->frames[i]);
+	}
+	free(stream->previous);
+	free(stream->scratch);
+	free(stream);
+}
+
+/**
+ * Open path, or standard output for -, and start a thread writing every
+ * every-th generation of boards of the given size to it, in the current
+ * rule, waiting for the writer rather than dropping any if lossless.
+ *
+ * @Return the stream, or NULL if it could not be opened or out of memory
+ */
+LifeStream *createStream(const char *path, int boardSize,
+			 unsigned long long every, boolean lossless)
+{
+	LifeStreamHeader header;
+
+	LifeStream *stream = (LifeStream *)calloc(1, sizeof(LifeStream));
+	if (stream == NULL) {
+		return NULL;
+	}
+
+	stream->boardSize = boardSize;
+	stream->words = (boardSize + 63) / 64;
+	stream->boardWords = (size_t)stream->words * boardSize;
+	stream->every = every > 0 ? every : 1;
+	stream->lossless = lossless;
+
+	size_t bytes = sizeof(uint64_t) * stream->boardWords;
+	boolean ok = true;
+	for (int i = 0; i < LIFE_STREAM_QUEUE; i++) {
+		stream->frames[i] = (uint64_t *)malloc(bytes);
+		ok = ok && stream->frames[i] != NULL;
+	}
+	stream->previous = (uint64_t *)calloc(1, bytes);
+	stream->scratch = (unsigned char *)malloc(2 * bytes + 16);
+	if (!ok || stream->previous == NULL || stream->scratch == NULL) {
+		freeStream(stream);
+		return NULL;
+	}
+
+	if (strcmp(path, "-") == 0) {
+		stream->file = stdout;
+	} else {
+		stream->file = fopen(path, "wb");
+		stream->closeFile = true;
+	}
+	if (stream->file == NULL) {
+		freeStream(stream);
+		return NULL;
+	}
+
+	(void)memset(&header, 0x0, sizeof(header));
+	(void)memcpy(header.magic, LIFE_STREAM_MAGIC, sizeof(header.magic));
+	header.version = LIFE_STREAM_VERSION;
+	header.headerSize = sizeof(header);
+	header.boardSize = (uint32_t)boardSize;
+	header.words = (uint32_t)stream->words;
+	header.birth = lifeRule.birth;
+	header.survival = lifeRule.survival;
+	header.every = (uint32_t)stream->every;
+	if (fwrite(&header, sizeof(header), 1, stream->file) != 1) {
+		freeStream(stream);
+		return NULL;
+	}
+
+	(void)pthread_mutex_init(&stream->lock, NULL);
+	(void)pthread_cond_init(&stream->wake, NULL);
+	(void)pthread_cond_init(&stream->space, NULL);
+	if (pthread_create(&stream->thread, NULL, &runStream, stream) != 0) {
+		(void)pthread_cond_destroy(&stream->space);
+		(void)pthread_cond_destroy(&stream->wake);
+		(void)pthread_mutex_destroy(&stream->lock);
+		freeStream(stream);
+		return NULL;
+	}
+
+	return stream;
+}
+
+/**
+ * Write out the generations still queued, stop the writer and close the
+ * stream, telling how many generations were dropped on the way.
+ */
+void destroyStream(LifeStream *stream)
+{
+	if (stream == NULL) {
+		return;
+	}
+
+	(void)pthread_mutex_lock(&stream->lock);
+	stream->stopping = true;
+	(void)pthread_cond_signal(&stream->wake);
+	(void)pthread_mutex_unlock(&stream->lock);
+	(void)pthread_join(stream->thread, NULL);
+
+	if (fflush(stream->file) != 0) {
+		stream->failed = true;
+	}
+	if (stream->failed) {
+		fprintf(stderr, "Not possible to write the whole stream.\n");
+	}
+	if (stream->dropped > 0) {
+		fprintf(stderr, "%llu generations were dropped from the "
+			"stream.\n", stream->dropped);
+	}
+
+	(void)pthread_cond_destroy(&stream->space);
+	(void)pthread_cond_destroy(&stream->wake);
+	(void)pthread_mutex_destroy(&stream->lock);
+	freeStream(stream);
+}
+
+/**
+ * Queue the board for writing if the generation is one to write. If the
+ * queue is full it is dropped, unless the stream is lossless, when this
+ * waits for room instead.
+ *
+ * @Return false if the generation was dropped
+ */
+boolean streamGeneration(LifeStream *stream, LifeBoard *board,
+			 unsigned long long generation)
+{
+	if (stream == NULL || board == NULL ||
+	    board->boardSize != stream->boardSize) {
+		return false;
+	}
+	if (generation % stream->every != 0) {
+		return true;
+	}
+
+	(void)pthread_mutex_lock(&stream->lock);
+	while (stream->lossless && stream->count == LIFE_STREAM_QUEUE) {
+		(void)pthread_cond_wait(&stream->space, &stream->lock);
+	}
+	boolean full = stream->count == LIFE_STREAM_QUEUE;
+	if (full) {
+		stream->dropped++;
+	}
+	size_t tail = (stream->head + stream->count) % LIFE_STREAM_QUEUE;
+	(void)pthread_mutex_unlock(&stream->lock);
+	if (full) {
+		return false;
+	}
+
+	// the writer leaves the frame at the tail alone until it is counted.
+	uint64_t *frame = stream->frames[tail];
+	int last = stream->boardSize % 64;
+	uint64_t mask = last ? ((uint64_t)1 << last) - 1 : ~(uint64_t)0;
+	for (int y = 0; y < stream->boardSize; y++) {
+		uint64_t *row = frame + (size_t)y * stream->words;
+		(void)memcpy(row, lifeRow(board, y),
+			     sizeof(uint64_t) * stream->words);
+		row[stream->words - 1] &= mask;
+	}
+
+	(void)pthread_mutex_lock(&stream->lock);
+	stream->generations[tail] = generation;
+	stream->count++;
+	(void)pthread_cond_signal(&stream->wake);
+	(void)pthread_mutex_unlock(&stream->lock);
+
+	return true;
+}
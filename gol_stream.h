@@ -0,0 +1,119 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_STREAM_H_
+#define __GOL_STREAM_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gol_backend.h"
+#include "gol_kernel.h"
+
+#define LIFE_STREAM_MAGIC   "GOLDELTA"
+#define LIFE_STREAM_VERSION 1
+
+/* Generations that can wait for the writer before more are dropped. */
+#define LIFE_STREAM_QUEUE 8
+
+/* Records between keyframes, for readers joining a stream late. */
+#define LIFE_STREAM_KEY_INTERVAL 256
+
+/*
+ * A stream of generations for other programs to follow, starting with a
+ * LifeStreamHeader and then a LifeStreamRecord for every generation
+ * written, each followed by length bytes of data. Both are in the byte
+ * order of the machine writing them, which has to be little endian.
+ *
+ * A frame is the board as boardSize rows of words 64 bit words, with cell
+ * x of a row in bit x % 64 of word x / 64 and the bits past the edge
+ * cleared, taken as bytes. The data of a record is a list of runs, each
+ * two numbers and then bytes: the number of bytes to skip, then the
+ * number of bytes that follow, which are XORed into the frame from there
+ * on. Numbers are written seven bits at a time, lowest first, with the
+ * top bit set on all but the last byte of each.
+ *
+ * A keyframe is XORed into a frame of dead cells, and any other record
+ * into the frame of the record before it, so the frame of any record is
+ * found by starting at a keyframe and applying the records after it.
+ * Generations dropped because the writer could not keep up are left out,
+ * and their changes end up in the next record written.
+ */
+typedef struct LifeStreamHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t boardSize;
+	uint32_t words;
+	uint16_t birth;
+	uint16_t survival;
+	uint32_t every;
+} LifeStreamHeader;
+
+typedef struct LifeStreamRecord
+{
+	uint64_t generation;
+	uint32_t keyframe;
+	uint32_t reserved;
+	uint64_t length;
+} LifeStreamRecord;
+
+/*
+ * A writer thread and the queue of frames copied for it. The simulation
+ * only copies every generation it hands over into a free frame, and the
+ * writer encodes and writes it. When the queue is full the generation is
+ * dropped, or, for a lossless stream, the simulation waits for a frame to
+ * be written, so a slow disk or reader costs either generations or time
+ * but only once it is LIFE_STREAM_QUEUE generations behind.
+ */
+typedef struct LifeStream
+{
+	FILE *file;
+	boolean closeFile;
+	int boardSize;
+	int words;
+	size_t boardWords;
+	unsigned long long every;
+	uint64_t *frames[LIFE_STREAM_QUEUE];
+	unsigned long long generations[LIFE_STREAM_QUEUE];
+	uint64_t *previous;
+	unsigned char *scratch;
+	size_t head;
+	size_t count;
+	unsigned long long written;
+	unsigned long long dropped;
+	boolean failed;
+	boolean lossless;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t space;
+	boolean stopping;
+} LifeStream;
+
+LifeStream *createStream(const char *, int, unsigned long long, boolean);
+void destroyStream(LifeStream *);
+boolean streamGeneration(LifeStream *, LifeBoard *, unsigned long long);
+
+#endif
@@ -0,0 +1,850 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "gol_transport.h"
+
+/* A receive that has been posted and not yet waited for. */
+typedef struct PendingMessage
+{
+	int peer;
+	void *buffer;
+	size_t length;
+	size_t received;
+	boolean posted;
+} PendingMessage;
+
+/**
+ * Get the time in seconds from some fixed point.
+ */
+static double currentSeconds(void)
+{
+	struct timespec now;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/**
+ * Post a receive of length bytes with tag into pending, checking that the
+ * tag is not taken.
+ */
+static boolean postMessage(PendingMessage *pending, int peer, int tag,
+			   void *buffer, size_t length)
+{
+	if (tag < 0 || tag >= LIFE_TRANSPORT_TAGS || pending[tag].posted) {
+		return false;
+	}
+
+	pending[tag].peer = peer;
+	pending[tag].buffer = buffer;
+	pending[tag].length = length;
+	pending[tag].received = 0;
+	pending[tag].posted = true;
+
+	return true;
+}
+
+/*
+ * The shared memory transport has a slot for every receiver and tag, two
+ * in fact, since a sender can be one round ahead of the receiver: it can
+ * only get further than that by receiving something the receiver sends
+ * once it has read what it was sent, so the slot of the round before is
+ * free by then. A message is written into the slot of the round it
+ * belongs to, and the sequence number of the slot set to the round after
+ * it once it is complete.
+ */
+typedef struct SharedSlot
+{
+	uint64_t sequence;
+	uint64_t length;
+} SharedSlot;
+
+typedef struct SharedTransport
+{
+	LifeTransport transport;
+	unsigned char *region;
+	size_t regionSize;
+	size_t slotSize;
+	size_t maxBytes;
+	unsigned long long round;
+	PendingMessage pending[LIFE_TRANSPORT_TAGS];
+} SharedTransport;
+
+/**
+ * Get the slot for messages with tag to receiver in the given round.
+ */
+static SharedSlot *sharedSlot(SharedTransport *shared, int receiver, int tag,
+			      unsigned long long round)
+{
+	size_t index = ((size_t)receiver * LIFE_TRANSPORT_TAGS + tag) * 2 +
+		(round & 1);
+
+	return (SharedSlot *)(shared->region + index * shared->slotSize);
+}
+
+static boolean sendShared(LifeTransport *transport, int peer, int tag,
+			  const void *buffer, size_t length)
+{
+	SharedTransport *shared = (SharedTransport *)transport;
+
+	if (peer < 0 || peer >= transport->ranks || tag < 0 ||
+	    tag >= LIFE_TRANSPORT_TAGS || length > shared->maxBytes) {
+		return false;
+	}
+
+	SharedSlot *slot = sharedSlot(shared, peer, tag, shared->round);
+	(void)memcpy(slot + 1, buffer, length);
+	slot->length = length;
+	__atomic_store_n(&slot->sequence, shared->round + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static boolean receiveShared(LifeTransport *transport, int peer, int tag,
+			     void *buffer, size_t length)
+{
+	SharedTransport *shared = (SharedTransport *)transport;
+
+	if (peer < 0 || peer >= transport->ranks) {
+		return false;
+	}
+
+	return postMessage(shared->pending, peer, tag, buffer, length);
+}
+
+static boolean waitShared(LifeTransport *transport)
+{
+	SharedTransport *shared = (SharedTransport *)transport;
+	int rank = transport->rank;
+	double deadline = currentSeconds() + LIFE_TRANSPORT_TIMEOUT;
+	boolean success = true;
+
+	for (int tag = 0; tag < LIFE_TRANSPORT_TAGS; tag++) {
+		PendingMessage *pending = &shared->pending[tag];
+		if (!pending->posted) {
+			continue;
+		}
+		pending->posted = false;
+
+		SharedSlot *slot = sharedSlot(shared, rank, tag, shared->round);
+		unsigned long spins = 0;
+		while (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) !=
+		       shared->round + 1) {
+			// the other process may well be waiting for this core.
+			(void)sched_yield();
+			if (++spins % 1024 == 0 && currentSeconds() > deadline) {
+				fprintf(stderr, "Rank %d timed out waiting for "
+					"rank %d.\n", rank, pending->peer);
+				return false;
+			}
+		}
+
+		if (slot->length != pending->length) {
+			success = false;
+			continue;
+		}
+		(void)memcpy(pending->buffer, slot + 1, pending->length);
+	}
+
+	shared->round++;
+
+	return success;
+}
+
+static void destroyShared(LifeTransport *transport)
+{
+	SharedTransport *shared = (SharedTransport *)transport;
+
+	(void)munmap(shared->region, shared->regionSize);
+	free(shared);
+}
+
+/**
+ * Create a transport for ranks processes on this host, sending messages of
+ * at most maxBytes through memory they all share. It has to be created
+ * before the processes are forked off, each of which then sets the rank
+ * of its own copy.
+ *
+ * @Return the transport with rank 0, or NULL if the memory could not be
+ * mapped
+ */
+LifeTransport *createSharedTransport(int ranks, size_t maxBytes)
+{
+	if (ranks <= 0) {
+		return NULL;
+	}
+
+	SharedTransport *shared =
+		(SharedTransport *)calloc(1, sizeof(SharedTransport));
+	if (shared == NULL) {
+		return NULL;
+	}
+
+	// slots on cache lines of their own, so writers do not collide.
+	size_t slotSize = sizeof(SharedSlot) + maxBytes;
+	slotSize = (slotSize + 63) & ~(size_t)63;
+	size_t regionSize = slotSize * (size_t)ranks * LIFE_TRANSPORT_TAGS * 2;
+
+	void *region = mmap(NULL, regionSize, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (region == MAP_FAILED) {
+		free(shared);
+		return NULL;
+	}
+
+	shared->transport.rank = 0;
+	shared->transport.ranks = ranks;
+	shared->transport.send = &sendShared;
+	shared->transport.receive = &receiveShared;
+	shared->transport.wait = &waitShared;
+	shared->transport.destroy = &destroyShared;
+	shared->region = (unsigned char *)region;
+	shared->regionSize = regionSize;
+	shared->slotSize = slotSize;
+	shared->maxBytes = maxBytes;
+
+	return &shared->transport;
+}
+
+/*
+ * The TCP transport keeps one connection to each peer, over which every
+ * message goes with a header of its tag and length. What is sent is
+ * queued for the peer and written as far as the socket takes it, and the
+ * rest while waiting. A peer is only read from while a receive from it is
+ * outstanding, so nothing of its next round is read before that has been
+ * posted.
+ */
+typedef struct TcpPeer
+{
+	int socket;
+	unsigned char *queue;
+	size_t queued;
+	size_t written;
+	size_t capacity;
+	uint32_t header[2];
+	size_t headerRead;
+	int tag;
+} TcpPeer;
+
+typedef struct TcpTransport
+{
+	LifeTransport transport;
+	TcpPeer *peers;
+	PendingMessage pending[LIFE_TRANSPORT_TAGS];
+} TcpTransport;
+
+/**
+ * Write as much of the queue for peer as the socket takes.
+ *
+ * @Return false if the connection failed
+ */
+static boolean flushPeer(TcpPeer *peer)
+{
+	while (peer->written < peer->queued) {
+		ssize_t n = send(peer->socket, peer->queue + peer->written,
+				 peer->queued - peer->written, MSG_NOSIGNAL);
+		if (n < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK ||
+				errno == EINTR;
+		}
+		peer->written += (size_t)n;
+	}
+
+	peer->queued = 0;
+	peer->written = 0;
+
+	return true;
+}
+
+/**
+ * Read as much of the message coming from peer as is there.
+ *
+ * @Return false if the connection failed or the message was not expected
+ */
+static boolean readPeer(TcpTransport *tcp, int index)
+{
+	TcpPeer *peer = &tcp->peers[index];
+
+	for (;;) {
+		unsigned char *target;
+		size_t wanted;
+		if (peer->tag < 0) {
+			target = (unsigned char *)peer->header + peer->headerRead;
+			wanted = sizeof(peer->header) - peer->headerRead;
+		} else {
+			PendingMessage *pending = &tcp->pending[peer->tag];
+			target = (unsigned char *)pending->buffer +
+				pending->received;
+			wanted = pending->length - pending->received;
+		}
+
+		ssize_t n = wanted ? recv(peer->socket, target, wanted, 0) : 0;
+		if (n < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK ||
+				errno == EINTR;
+		}
+		if (n == 0 && wanted > 0) {
+			return false;
+		}
+
+		if (peer->tag >= 0) {
+			PendingMessage *pending = &tcp->pending[peer->tag];
+			pending->received += (size_t)n;
+			if (pending->received == pending->length) {
+				pending->posted = false;
+				peer->tag = -1;
+				return true;
+			}
+			continue;
+		}
+
+		peer->headerRead += (size_t)n;
+		if (peer->headerRead < sizeof(peer->header)) {
+			continue;
+		}
+
+		// the message has to be one that was posted, from this peer
+		uint32_t tag = ntohl(peer->header[0]);
+		uint32_t length = ntohl(peer->header[1]);
+		peer->headerRead = 0;
+		if (tag >= LIFE_TRANSPORT_TAGS || !tcp->pending[tag].posted ||
+		    tcp->pending[tag].peer != index ||
+		    tcp->pending[tag].length != length) {
+			return false;
+		}
+		peer->tag = (int)tag;
+	}
+}
+
+/**
+ * Tell whether a receive from peer is still outstanding.
+ */
+static boolean expectingPeer(TcpTransport *tcp, int peer)
+{
+	for (int tag = 0; tag < LIFE_TRANSPORT_TAGS; tag++) {
+		if (tcp->pending[tag].posted && tcp->pending[tag].peer == peer) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static boolean sendTcp(LifeTransport *transport, int peer, int tag,
+		       const void *buffer, size_t length)
+{
+	TcpTransport *tcp = (TcpTransport *)transport;
+
+	if (peer < 0 || peer >= transport->ranks || tag < 0 ||
+	    tag >= LIFE_TRANSPORT_TAGS || length > UINT32_MAX) {
+		return false;
+	}
+
+	// messages to itself are received right away
+	if (peer == transport->rank) {
+		PendingMessage *pending = &tcp->pending[tag];
+		if (!pending->posted || pending->peer != peer ||
+		    pending->length != length) {
+			return false;
+		}
+		(void)memcpy(pending->buffer, buffer, length);
+		pending->posted = false;
+		return true;
+	}
+
+	TcpPeer *target = &tcp->peers[peer];
+	if (target->socket < 0) {
+		return false;
+	}
+
+	size_t needed = target->queued + sizeof(target->header) + length;
+	if (needed > target->capacity) {
+		unsigned char *queue =
+			(unsigned char *)realloc(target->queue, needed);
+		if (queue == NULL) {
+			return false;
+		}
+		target->queue = queue;
+		target->capacity = needed;
+	}
+
+	uint32_t header[2] = { htonl((uint32_t)tag), htonl((uint32_t)length) };
+	(void)memcpy(target->queue + target->queued, header, sizeof(header));
+	(void)memcpy(target->queue + target->queued + sizeof(header), buffer,
+		     length);
+	target->queued += sizeof(header) + length;
+
+	return flushPeer(target);
+}
+
+static boolean receiveTcp(LifeTransport *transport, int peer, int tag,
+			  void *buffer, size_t length)
+{
+	TcpTransport *tcp = (TcpTransport *)transport;
+
+	if (peer < 0 || peer >= transport->ranks ||
+	    (peer != transport->rank && tcp->peers[peer].socket < 0)) {
+		return false;
+	}
+
+	return postMessage(tcp->pending, peer, tag, buffer, length);
+}
+
+static boolean waitTcp(LifeTransport *transport)
+{
+	TcpTransport *tcp = (TcpTransport *)transport;
+	int ranks = transport->ranks;
+	struct pollfd fds[ranks];
+	int indices[ranks];
+	double deadline = currentSeconds() + LIFE_TRANSPORT_TIMEOUT;
+
+	for (;;) {
+		int count = 0;
+		for (int i = 0; i < ranks; i++) {
+			TcpPeer *peer = &tcp->peers[i];
+			if (peer->socket < 0) {
+				continue;
+			}
+
+			short events = 0;
+			if (peer->queued > 0) {
+				events |= POLLOUT;
+			}
+			if (expectingPeer(tcp, i)) {
+				events |= POLLIN;
+			}
+			if (events != 0) {
+				fds[count].fd = peer->socket;
+				fds[count].events = events;
+				fds[count].revents = 0;
+				indices[count++] = i;
+			}
+		}
+
+		if (count == 0) {
+			break;
+		}
+
+		double left = deadline - currentSeconds();
+		if (left <= 0) {
+			fprintf(stderr, "Rank %d timed out waiting for its "
+				"peers.\n", transport->rank);
+			return false;
+		}
+
+		int ready = poll(fds, (nfds_t)count, (int)(left * 1000) + 1);
+		if (ready < 0 && errno != EINTR) {
+			return false;
+		}
+
+		for (int i = 0; i < count && ready > 0; i++) {
+			TcpPeer *peer = &tcp->peers[indices[i]];
+			if ((fds[i].revents & POLLOUT) && !flushPeer(peer)) {
+				return false;
+			}
+			if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) &&
+			    !readPeer(tcp, indices[i])) {
+				fprintf(stderr, "Rank %d lost rank %d.\n",
+					transport->rank, indices[i]);
+				return false;
+			}
+		}
+	}
+
+	// a receive from itself that was never sent does not come
+	boolean success = true;
+	for (int tag = 0; tag < LIFE_TRANSPORT_TAGS; tag++) {
+		if (tcp->pending[tag].posted) {
+			tcp->pending[tag].posted = false;
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+static void destroyTcp(LifeTransport *transport)
+{
+	TcpTransport *tcp = (TcpTransport *)transport;
+
+	for (int i = 0; i < transport->ranks; i++) {
+		if (tcp->peers[i].socket >= 0) {
+			(void)close(tcp->peers[i].socket);
+		}
+		free(tcp->peers[i].queue);
+	}
+
+	free(tcp->peers);
+	free(tcp);
+}
+
+/**
+ * Split "host:port" into its host and port, the host into a buffer of
+ * size bytes.
+ *
+ * @Return the port, or NULL if there is none or the host does not fit
+ */
+static const char *splitAddress(const char *address, size_t length,
+				char *host, size_t size)
+{
+	const char *colon = NULL;
+
+	for (size_t i = 0; i < length; i++) {
+		if (address[i] == ':') {
+			colon = address + i;
+		}
+	}
+
+	if (colon == NULL || (size_t)(colon - address) >= size) {
+		return NULL;
+	}
+
+	(void)memcpy(host, address, (size_t)(colon - address));
+	host[colon - address] = '\0';
+
+	return colon + 1;
+}
+
+/**
+ * Look up the address of rank in the comma separated list addresses.
+ *
+ * @Return the addresses found, to be freed with freeaddrinfo, or NULL
+ */
+static struct addrinfo *findAddress(const char *addresses, int rank,
+				    boolean passive)
+{
+	const char *start = addresses;
+
+	for (int i = 0; i < rank && start != NULL; i++) {
+		start = strchr(start, ',');
+		if (start != NULL) {
+			start++;
+		}
+	}
+	if (start == NULL) {
+		return NULL;
+	}
+
+	const char *end = strchr(start, ',');
+	size_t length = end != NULL ? (size_t)(end - start) : strlen(start);
+	char host[256];
+	char port[16];
+	const char *portStart = splitAddress(start, length, host, sizeof(host));
+	if (portStart == NULL ||
+	    (size_t)(start + length - portStart) >= sizeof(port)) {
+		return NULL;
+	}
+	(void)memcpy(port, portStart, (size_t)(start + length - portStart));
+	port[start + length - portStart] = '\0';
+
+	struct addrinfo hints;
+	(void)memset(&hints, 0x0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+	struct addrinfo *result = NULL;
+	if (getaddrinfo(passive || host[0] == '\0' ? NULL : host, port,
+			&hints, &result) != 0) {
+		return NULL;
+	}
+
+	return result;
+}
+
+/**
+ * Start listening on the port of rank, on all interfaces.
+ *
+ * @Return the socket, or -1
+ */
+static int listenRank(const char *addresses, int rank)
+{
+	struct addrinfo *info = findAddress(addresses, rank, true);
+	if (info == NULL) {
+		return -1;
+	}
+
+	int listener = socket(info->ai_family, info->ai_socktype,
+			      info->ai_protocol);
+	int on = 1;
+	if (listener >= 0 &&
+	    (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on,
+			sizeof(on)) != 0 ||
+	     bind(listener, info->ai_addr, info->ai_addrlen) != 0 ||
+	     listen(listener, LIFE_TRANSPORT_TAGS) != 0)) {
+		(void)close(listener);
+		listener = -1;
+	}
+
+	freeaddrinfo(info);
+
+	return listener;
+}
+
+/**
+ * Connect to rank, trying again until it listens or the time is up, and
+ * tell it who is calling.
+ *
+ * @Return the socket, or -1
+ */
+static int connectRank(const char *addresses, int rank, int self,
+		       double deadline)
+{
+	struct addrinfo *info = findAddress(addresses, rank, false);
+	if (info == NULL) {
+		return -1;
+	}
+
+	int connection = -1;
+	while (connection < 0 && currentSeconds() < deadline) {
+		for (struct addrinfo *i = info; i != NULL; i = i->ai_next) {
+			connection = socket(i->ai_family, i->ai_socktype,
+					    i->ai_protocol);
+			if (connection < 0) {
+				continue;
+			}
+			if (connect(connection, i->ai_addr, i->ai_addrlen) == 0) {
+				break;
+			}
+			(void)close(connection);
+			connection = -1;
+		}
+
+		if (connection < 0) {
+			(void)usleep(100000);
+		}
+	}
+
+	freeaddrinfo(info);
+
+	uint32_t caller = htonl((uint32_t)self);
+	if (connection >= 0 &&
+	    send(connection, &caller, sizeof(caller), MSG_NOSIGNAL) !=
+	    (ssize_t)sizeof(caller)) {
+		(void)close(connection);
+		connection = -1;
+	}
+
+	return connection;
+}
+
+/**
+ * Accept a connection and find out which rank is calling.
+ *
+ * @Return the socket, or -1
+ */
+static int acceptRank(int listener, int ranks, int *rank, double deadline)
+{
+	struct pollfd fd = { listener, POLLIN, 0 };
+	double left = deadline - currentSeconds();
+
+	if (left <= 0 || poll(&fd, 1, (int)(left * 1000) + 1) <= 0) {
+		return -1;
+	}
+
+	int connection = accept(listener, NULL, NULL);
+	if (connection < 0) {
+		return -1;
+	}
+
+	uint32_t caller = 0;
+	if (recv(connection, &caller, sizeof(caller), MSG_WAITALL) !=
+	    (ssize_t)sizeof(caller) || (int)ntohl(caller) < 0 ||
+	    (int)ntohl(caller) >= ranks) {
+		(void)close(connection);
+		return -1;
+	}
+
+	*rank = (int)ntohl(caller);
+
+	return connection;
+}
+
+/**
+ * Create a transport for rank, connected over TCP to the count peers it
+ * exchanges messages with. The comma separated addresses have a host:port
+ * for every rank, the number of which gives the number of ranks; rank
+ * listens on its port, calls the peers above it and is called by those
+ * below it.
+ *
+ * @Return the transport, or NULL if not all the peers could be reached
+ */
+LifeTransport *createTcpTransport(int rank, const char *addresses,
+				  const int *peers, int count)
+{
+	int ranks = 1;
+	for (const char *c = addresses; *c != '\0'; c++) {
+		ranks += *c == ',';
+	}
+	if (rank < 0 || rank >= ranks) {
+		return NULL;
+	}
+
+	TcpTransport *tcp = (TcpTransport *)calloc(1, sizeof(TcpTransport));
+	if (tcp == NULL) {
+		return NULL;
+	}
+	tcp->peers = (TcpPeer *)calloc((size_t)ranks, sizeof(TcpPeer));
+	if (tcp->peers == NULL) {
+		free(tcp);
+		return NULL;
+	}
+
+	tcp->transport.rank = rank;
+	tcp->transport.ranks = ranks;
+	tcp->transport.send = &sendTcp;
+	tcp->transport.receive = &receiveTcp;
+	tcp->transport.wait = &waitTcp;
+	tcp->transport.destroy = &destroyTcp;
+	for (int i = 0; i < ranks; i++) {
+		tcp->peers[i].socket = -1;
+		tcp->peers[i].tag = -1;
+	}
+
+	int listener = listenRank(addresses, rank);
+	if (listener < 0) {
+		fprintf(stderr, "Rank %d could not listen on its port.\n", rank);
+		destroyTcp(&tcp->transport);
+		return NULL;
+	}
+
+	double deadline = currentSeconds() + LIFE_TRANSPORT_TIMEOUT;
+	boolean success = true;
+	int callers = 0;
+
+	for (int i = 0; i < count && success; i++) {
+		int peer = peers[i];
+		if (peer < 0 || peer >= ranks) {
+			success = false;
+		} else if (peer > rank && tcp->peers[peer].socket == -1) {
+			tcp->peers[peer].socket =
+				connectRank(addresses, peer, rank, deadline);
+			success = tcp->peers[peer].socket >= 0;
+		} else if (peer < rank && tcp->peers[peer].socket == -1) {
+			// mark it so it is only counted once
+			tcp->peers[peer].socket = -2;
+			callers++;
+		}
+	}
+
+	while (success && callers > 0) {
+		int caller = -1;
+		int connection = acceptRank(listener, ranks, &caller, deadline);
+		if (connection < 0 || tcp->peers[caller].socket != -2) {
+			if (connection >= 0) {
+				(void)close(connection);
+			}
+			success = false;
+			break;
+		}
+		tcp->peers[caller].socket = connection;
+		callers--;
+	}
+
+	(void)close(listener);
+
+	for (int i = 0; i < ranks && success; i++) {
+		int connection = tcp->peers[i].socket;
+		int on = 1;
+		if (connection >= 0) {
+			(void)setsockopt(connection, IPPROTO_TCP, TCP_NODELAY,
+					 &on, sizeof(on));
+			(void)fcntl(connection, F_SETFL,
+				    fcntl(connection, F_GETFL) | O_NONBLOCK);
+		}
+	}
+
+	if (!success) {
+		fprintf(stderr, "Rank %d could not reach all of its peers.\n",
+			rank);
+		for (int i = 0; i < ranks; i++) {
+			if (tcp->peers[i].socket == -2) {
+				tcp->peers[i].socket = -1;
+			}
+		}
+		destroyTcp(&tcp->transport);
+		return NULL;
+	}
+
+	return &tcp->transport;
+}
+
+/**
+ * Close the connections of a transport and free it.
+ */
+void destroyTransport(LifeTransport *transport)
+{
+	if (transport != NULL) {
+		transport->destroy(transport);
+	}
+}
+
+/**
+ * Send length bytes from buffer to peer, as the message with tag for this
+ * round. The buffer may be reused once the call returns.
+ *
+ * @Return false if the message could not be sent
+ */
+boolean sendMessage(LifeTransport *transport, int peer, int tag,
+		    const void *buffer, size_t length)
+{
+	return transport->send(transport, peer, tag, buffer, length);
+}
+
+/**
+ * Post a receive of the message with tag from peer into buffer, which has
+ * to be exactly length bytes, and is filled in by the next wait.
+ *
+ * @Return false if the tag is already taken
+ */
+boolean receiveMessage(LifeTransport *transport, int peer, int tag,
+		       void *buffer, size_t length)
+{
+	return transport->receive(transport, peer, tag, buffer, length);
+}
+
+/**
+ * Wait for all the receives of this round, and finish the sends, so the
+ * next round can start.
+ *
+ * @Return false if a message did not arrive in time or was not as expected
+ */
+boolean waitMessages(LifeTransport *transport)
+{
+	return transport->wait(transport);
+}
@@ -0,0 +1,67 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#ifndef __GOL_TRANSPORT_H_
+#define __GOL_TRANSPORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gol_backend.h"
+
+/* Tags a message can have, one for each direction it can go in. */
+#define LIFE_TRANSPORT_TAGS 8
+
+/* Seconds to wait for a message or a peer before giving up on them. */
+#define LIFE_TRANSPORT_TIMEOUT 30
+
+/*
+ * A way for the ranks of a distributed board to send each other messages,
+ * with one implementation for processes on the same host and one for any
+ * host. A rank only ever has one message of each tag on the way to or
+ * from it at a time.
+ *
+ * A round starts with the receives, goes on with the sends and ends with a
+ * wait, which returns once everything received has arrived and everything
+ * sent is on its way. Until then the receive buffers belong to the
+ * transport, and the rank is free to do other work while the messages go.
+ */
+typedef struct LifeTransport LifeTransport;
+
+struct LifeTransport
+{
+	int rank;
+	int ranks;
+	boolean (*send)(LifeTransport *, int, int, const void *, size_t);
+	boolean (*receive)(LifeTransport *, int, int, void *, size_t);
+	boolean (*wait)(LifeTransport *);
+	void (*destroy)(LifeTransport *);
+};
+
+LifeTransport *createSharedTransport(int, size_t);
+LifeTransport *createTcpTransport(int, const char *, const int *, int);
+void destroyTransport(LifeTransport *);
+boolean sendMessage(LifeTransport *, int, int, const void *, size_t);
+boolean receiveMessage(LifeTransport *, int, int, void *, size_t);
+boolean waitMessages(LifeTransport *);
+
+#endif
@@ -0,0 +1,178 @@
+/* 
+ * Copyright (c) 2011 Peter Joensson <peter.joensson@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the right
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "gol_workers.h"
+
+typedef struct Worker
+{
+	WorkerPool *pool;
+	int index;
+} Worker;
+
+/**
+ * Main loop of every thread but the first; wait for the next round, run
+ * the task and report back.
+ */
+static void *runWorker(void *arg)
+{
+	Worker *worker = (Worker *)arg;
+	WorkerPool *pool = worker->pool;
+	int index = worker->index;
+	unsigned long round = 0;
+
+	free(worker);
+
+	(void)pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (pool->round == round && !pool->stopping) {
+			(void)pthread_cond_wait(&pool->start, &pool->lock);
+		}
+		if (pool->stopping) {
+			break;
+		}
+		round = pool->round;
+
+		WorkerTask task = pool->task;
+		void *taskArg = pool->arg;
+		(void)pthread_mutex_unlock(&pool->lock);
+
+		task(taskArg, index, pool->threads);
+
+		(void)pthread_mutex_lock(&pool->lock);
+		if (--pool->pending == 0) {
+			(void)pthread_cond_signal(&pool->done);
+		}
+	}
+	(void)pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/**
+ * Create a pool of the given number of threads, the calling one included.
+ *
+ * @Return the pool, or NULL if out of memory or the threads could not be
+ * started
+ */
+WorkerPool *createWorkerPool(int threads)
+{
+	if (threads <= 0) {
+		return NULL;
+	}
+
+	WorkerPool *pool = (WorkerPool *)malloc(sizeof(WorkerPool));
+	if (pool == NULL) {
+		return NULL;
+	}
+
+	pool->threads = threads;
+	pool->handles = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+	if (pool->handles == NULL) {
+		free(pool);
+		return NULL;
+	}
+	pool->round = 0;
+	pool->pending = 0;
+	pool->stopping = 0;
+	pool->task = NULL;
+	pool->arg = NULL;
+	(void)pthread_mutex_init(&pool->lock, NULL);
+	(void)pthread_cond_init(&pool->start, NULL);
+	(void)pthread_cond_init(&pool->done, NULL);
+
+	for (int i = 1; i < threads; i++) {
+		Worker *worker = (Worker *)malloc(sizeof(Worker));
+		if (worker == NULL) {
+			pool->threads = i;
+			destroyWorkerPool(pool);
+			return NULL;
+		}
+		worker->pool = pool;
+		worker->index = i;
+
+		if (pthread_create(&pool->handles[i], NULL, &runWorker,
+				   worker) != 0) {
+			free(worker);
+			pool->threads = i;
+			destroyWorkerPool(pool);
+			return NULL;
+		}
+	}
+
+	return pool;
+}
+
+/**
+ * Stop and join all the threads of the pool.
+ */
+void destroyWorkerPool(WorkerPool *pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+
+	(void)pthread_mutex_lock(&pool->lock);
+	pool->stopping = 1;
+	(void)pthread_cond_broadcast(&pool->start);
+	(void)pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 1; i < pool->threads; i++) {
+		(void)pthread_join(pool->handles[i], NULL);
+	}
+
+	(void)pthread_cond_destroy(&pool->done);
+	(void)pthread_cond_destroy(&pool->start);
+	(void)pthread_mutex_destroy(&pool->lock);
+	free(pool->handles);
+	free(pool);
+}
+
+/**
+ * Run a task on every thread of the pool and wait until all of them are
+ * done with it.
+ */
+void runWorkerPool(WorkerPool *pool, WorkerTask task, void *arg)
+{
+	if (pool == NULL || pool->threads == 1) {
+		task(arg, 0, 1);
+		return;
+	}
+
+	(void)pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->pending = pool->threads - 1;
+	pool->round++;
+	(void)pthread_cond_broadcast(&pool->start);
+	(void)pthread_mutex_unlock(&pool->lock);
+
+	task(arg, 0, pool->threads);
+
+	(void)pthread_mutex_lock(&pool->lock);
+	while (pool->pending > 0) {
+		(void)pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	(void)pthread_mutex_unlock(&pool->lock);
+}
@@ -20,67 +20,39 @@
  * THE SOFTWARE
  */
 
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
+#ifndef __GOL_WORKERS_H_
+#define __GOL_WORKERS_H_
 
-#include "list.h"
+#include <pthread.h>
 
-/**
- *
- *
+/*
+ * A task is called once on every thread in the pool with the index of the
+ * thread and the number of threads, and is expected to pick its own share
+ * of the work from those.
  */
-CircularList *createCircularList(unsigned int size)
-{
-	CircularList *list = NULL;
-
-#ifdef _DEBUG_
-	printf("Creating a new circular list of size %d.\n", size);
-	fflush(NULL);
-#endif
-	
-	list = (CircularList *)malloc(sizeof(CircularList));
-	list->nodes = (Node *)malloc(sizeof(Node) * size);
-	(void)memset(list->nodes, 0x0, (sizeof(Node) * size));
-	list->size = size;
-	list->next = 0;
-
-	return list;
-}
+typedef void (*WorkerTask)(void *, int, int);
 
-/**
- *
- *
+/*
+ * A fixed set of threads that are started once and then handed one task
+ * at a time. The thread running the task takes part as index 0, so a pool
+ * of n threads starts n - 1 of its own.
  */
-void destroyCircularList(CircularList *list)
-{
-#ifdef _DEBUG_
-	printf("Deleting circular list 0x%d.\n", (int)list);
-	fflush(NULL);
-#endif
-	for (int i=0; i<list->size; i++) {
-		Node n = list->nodes[i];
-		void *d = n.value;
-		if (d != NULL) {
-			printf("Freeing 0x%d\n", (int)n.value);
-			free(n.value);
-		}
-	}
-	free(list->nodes);
-	free(list);
-	
-	return;
-}
-
-void addToCircularList(CircularList *list, void *data)
+typedef struct WorkerPool
 {
-//#ifdef _DEBUG_
-	printf("Adding 0x%d\tto list 0x%d.\n", (int)data, (int)list);
-	fflush(NULL);
-//#endif
-	list->nodes[list->next].value = data;
-	// remove parenthesis for fun effects ;)
-	list->next = (list->next + 1) % list->size;
+	int threads;
+	pthread_t *handles;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned long round;
+	int pending;
+	int stopping;
+	WorkerTask task;
+	void *arg;
+} WorkerPool;
+
+WorkerPool *createWorkerPool(int);
+void destroyWorkerPool(WorkerPool *);
+void runWorkerPool(WorkerPool *, WorkerTask, void *);
 
-	return;
-}
+#endif